@@ -0,0 +1,553 @@
+/*
+ * bench.c
+ * Copyleft (C) 2016-2017 Chad Mowery
+ *
+ *
+ * bench.c is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bench.c is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "binaryheap.h"
+#include "kmerge.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+/* NOTE: Build once per BINARY_HEAP_ARITY, see `make bench`
+ *
+ * Usage: ./bench-4 [max n] [workload]
+ *
+ * Runs every workload at n = 1e2, 1e3, ... up to max n (default 1e6, up to
+ * 1e8 needs about 2GB) with each key distribution. Small heaps are rerun
+ * until at least BENCH_MIN_OPS operations were timed. Reports ns/op,
+ * comparisons per op (comparitor calls, or key compares on keyed heaps)
+ * and the peak RSS of the process so far. */
+
+#define BENCH_MIN_OPS 1000000
+
+/* Key distributions */
+#define DIST_RANDOM  0
+#define DIST_SORTED  1
+#define DIST_REVERSE 2
+#define DIST_DUPS    3
+#define DIST_COUNT   4
+
+const char* dist_names[DIST_COUNT] = { "random", "sorted", "reverse", "dups" };
+
+/* Bench comparitor */
+int min(void* a, void* b)
+{
+    return (*(int*)a > *(int*)b) - (*(int*)a < *(int*)b);
+}
+
+/* Bench helpers */
+unsigned long long rng_state = 88172645463325252ULL;
+unsigned long long rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Peak resident set size of the process, in MB */
+double peak_rss_mb(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+void report(const char* workload, const char* dist, size_t n, size_t ops, double elapsed, size_t comparisons)
+{
+    printf("arity %-2d  %-10s %-8s n=%-10lu %8.1f ns/op %6.1f cmp/op %8.1f MB peak\n",
+           BINARY_HEAP_ARITY, workload, dist, (unsigned long)n, elapsed / (double)ops,
+           (double)comparisons / (double)ops, peak_rss_mb());
+}
+
+/* Number of times to rerun a workload of n ops */
+size_t reps_for(size_t n)
+{
+    return (n >= BENCH_MIN_OPS ? 1 : BENCH_MIN_OPS / n);
+}
+
+void fill_values(int* values, size_t n, int dist)
+{
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        switch (dist) {
+        case DIST_SORTED:  values[i] = (int)i; break;
+        case DIST_REVERSE: values[i] = (int)(n - i); break;
+        case DIST_DUPS:    values[i] = (int)(rng_next() % 16); break;
+        default:           values[i] = (int)(rng_next() & 0x7fffffff); break;
+        }
+    }
+}
+
+/* Push n elements into an empty heap */
+void bench_push(int* values, size_t n, const char* dist)
+{
+    size_t reps = reps_for(n);
+    size_t comparisons = 0;
+    double elapsed = 0;
+
+    size_t r, i;
+    for (r = 0; r < reps; ++r) {
+        binary_heap_t* heap;
+        binary_heap_new(&heap, &min);
+
+        double start = now_ns();
+        for (i = 0; i < n; ++i)
+            binary_heap_push(heap, &values[i]);
+        elapsed += now_ns() - start;
+
+        comparisons += binary_heap_comparisons(heap);
+        binary_heap_destroy(heap);
+    }
+
+    report("push", dist, n, n * reps, elapsed, comparisons);
+}
+
+/* Bulk load n elements, then pop all of them */
+void bench_pop(int* values, void** data, size_t n, const char* dist)
+{
+    size_t reps = reps_for(n);
+    size_t comparisons = 0;
+    double elapsed = 0;
+
+    size_t r, i;
+    for (r = 0; r < reps; ++r) {
+        for (i = 0; i < n; ++i)
+            data[i] = &values[i];
+
+        binary_heap_t* heap;
+        binary_heap_new_from_array(&heap, &min, data, n);
+        size_t loaded = binary_heap_comparisons(heap);
+
+        void* out;
+        double start = now_ns();
+        for (i = 0; i < n; ++i)
+            binary_heap_pop(heap, &out);
+        elapsed += now_ns() - start;
+
+        comparisons += binary_heap_comparisons(heap) - loaded;
+        binary_heap_destroy(heap);
+    }
+
+    report("pop", dist, n, n * reps, elapsed, comparisons);
+}
+
+/* Same as pop on a keyed heap, so sifts never call the comparitor. Scalar
+ * runs turn off SIMD child selection to compare against it. */
+void bench_pop_keyed(int* values, size_t n, const char* dist, int simd)
+{
+    size_t reps = reps_for(n);
+    size_t comparisons = 0;
+    double elapsed = 0;
+
+    size_t r, i;
+    for (r = 0; r < reps; ++r) {
+        binary_heap_t* heap;
+        binary_heap_new_keyed(&heap);
+        binary_heap_set_simd(heap, simd);
+        for (i = 0; i < n; ++i)
+            binary_heap_push_key(heap, (uint64_t)values[i], &values[i]);
+        size_t loaded = binary_heap_comparisons(heap);
+
+        void* out;
+        double start = now_ns();
+        for (i = 0; i < n; ++i)
+            binary_heap_pop(heap, &out);
+        elapsed += now_ns() - start;
+
+        comparisons += binary_heap_comparisons(heap) - loaded;
+        binary_heap_destroy(heap);
+    }
+
+    report(simd ? "pop-keyed" : "pop-scalar", dist, n, n * reps, elapsed, comparisons);
+}
+
+/* n random pushes and pops, pushes twice as likely, from an empty heap */
+void bench_mix(int* values, size_t n, const char* dist)
+{
+    size_t reps = reps_for(n);
+    size_t comparisons = 0;
+    double elapsed = 0;
+
+    size_t r, i;
+    for (r = 0; r < reps; ++r) {
+        binary_heap_t* heap;
+        binary_heap_new(&heap, &min);
+
+        void* out;
+        size_t next = 0;
+        double start = now_ns();
+        for (i = 0; i < n; ++i) {
+            if (rng_next() % 3 != 0)
+                binary_heap_push(heap, &values[next++]);
+            else
+                binary_heap_pop(heap, &out);
+        }
+        elapsed += now_ns() - start;
+
+        comparisons += binary_heap_comparisons(heap);
+        binary_heap_destroy(heap);
+    }
+
+    report("mix", dist, n, n * reps, elapsed, comparisons);
+}
+
+/* Hold model: a heap of n elements, each op pops the top and pushes it
+ * back later by a random increment, so the size stays at n. Fused holds
+ * do both with a single binary_heap_replace. */
+void bench_hold(int* values, void** data, size_t n, const char* dist, int fused)
+{
+    size_t reps = reps_for(n);
+    size_t comparisons = 0;
+    double elapsed = 0;
+
+    size_t r, i;
+    for (r = 0; r < reps; ++r) {
+        for (i = 0; i < n; ++i)
+            data[i] = &values[i];
+
+        binary_heap_t* heap;
+        binary_heap_new_from_array(&heap, &min, data, n);
+        size_t loaded = binary_heap_comparisons(heap);
+
+        void* out;
+        double start = now_ns();
+        for (i = 0; i < n; ++i) {
+            if (fused) {
+                binary_heap_peek(heap, &out);
+                *(int*)out += (int)(rng_next() % 1024);
+                binary_heap_replace(heap, out, &out);
+            }
+            else {
+                binary_heap_pop(heap, &out);
+                *(int*)out += (int)(rng_next() % 1024);
+                binary_heap_push(heap, out);
+            }
+        }
+        elapsed += now_ns() - start;
+
+        comparisons += binary_heap_comparisons(heap) - loaded;
+        binary_heap_destroy(heap);
+    }
+
+    /* Values drifted, later workloads refill them */
+    report(fused ? "hold-fused" : "hold", dist, n, 2 * n * reps, elapsed, comparisons);
+}
+
+/* Hold model on keyed heaps, where keys only grow as in an event
+ * simulation, on a binary heap or a radix heap */
+void bench_monotone(int* values, size_t n, const char* dist, int radix)
+{
+    size_t reps = reps_for(n);
+    size_t comparisons = 0;
+    double elapsed = 0;
+
+    size_t r, i;
+    for (r = 0; r < reps; ++r) {
+        binary_heap_t* heap;
+        if (radix)
+            binary_heap_new_radix(&heap);
+        else
+            binary_heap_new_keyed(&heap);
+        for (i = 0; i < n; ++i)
+            binary_heap_push_key(heap, (uint64_t)values[i], &values[i]);
+        size_t loaded = binary_heap_comparisons(heap);
+
+        uint64_t key;
+        void* out;
+        double start = now_ns();
+        for (i = 0; i < n; ++i) {
+            binary_heap_peek_key(heap, &key);
+            binary_heap_pop(heap, &out);
+            binary_heap_push_key(heap, key + rng_next() % 1024, out);
+        }
+        elapsed += now_ns() - start;
+
+        comparisons += binary_heap_comparisons(heap) - loaded;
+        binary_heap_destroy(heap);
+    }
+
+    report(radix ? "mono-radix" : "monotone", dist, n, 2 * n * reps, elapsed, comparisons);
+}
+
+/* A run of values[] read front to back, as a merge source */
+typedef struct {
+    const int* next;
+    const int* end;
+} bench_run_t;
+
+int bench_run_next(void* source, void* out)
+{
+    bench_run_t* run = (bench_run_t*)source;
+    if (run->next == run->end)
+        return 0;
+
+    *(int*)out = *run->next++;
+    return 1;
+}
+
+/* Merge head, the source follows the value so min compares the value */
+typedef struct {
+    int    value;
+    size_t source;
+} bench_head_t;
+
+#define BENCH_MERGE_NAIVE -1
+#define BENCH_MERGE_K      256
+#define BENCH_MERGE_BATCH  1024
+
+/* Merge up to BENCH_MERGE_K sorted runs of values into batches, with a pop
+ * and a push per element on a sized heap, or with kmerge_t in either mode */
+void bench_kmerge(int* values, bench_run_t* runs, void** sources, size_t n, int mode)
+{
+    size_t k = (n / 10 < BENCH_MERGE_K ? n / 10 : BENCH_MERGE_K);
+    size_t reps = reps_for(n);
+    size_t comparisons = 0;
+    double elapsed = 0;
+    int batch[BENCH_MERGE_BATCH];
+
+    size_t r, s, i;
+    for (i = 0; i < n; ++i)
+        values[i] = (i % (n / k) == 0 ? 0 : values[i - 1]) + (int)(rng_next() % 1024);
+
+    for (r = 0; r < reps; ++r) {
+        for (s = 0; s < k; ++s) {
+            runs[s].next = values + s * (n / k);
+            runs[s].end = (s == k - 1 ? values + n : runs[s].next + n / k);
+            sources[s] = &runs[s];
+        }
+
+        double start = now_ns();
+        if (mode == BENCH_MERGE_NAIVE) {
+            binary_heap_t* heap;
+            bench_head_t head;
+            binary_heap_new_sized(&heap, sizeof(bench_head_t), &min);
+            for (s = 0; s < k; ++s) {
+                head.source = s;
+                if (bench_run_next(sources[s], &head.value))
+                    binary_heap_push_value(heap, &head);
+            }
+
+            i = 0;
+            while (binary_heap_pop_value(heap, &head)) {
+                batch[i++ % BENCH_MERGE_BATCH] = head.value;
+                if (bench_run_next(sources[head.source], &head.value))
+                    binary_heap_push_value(heap, &head);
+            }
+
+            comparisons += binary_heap_comparisons(heap);
+            binary_heap_destroy(heap);
+        }
+        else {
+            kmerge_t* merge;
+            kmerge_new(&merge, sizeof(int), &min, &bench_run_next, sources, k, mode);
+            while (kmerge_read(merge, batch, BENCH_MERGE_BATCH) == BENCH_MERGE_BATCH)
+                ;
+
+            comparisons += kmerge_comparisons(merge);
+            kmerge_destroy(merge);
+        }
+        elapsed += now_ns() - start;
+    }
+
+    report(mode == BENCH_MERGE_NAIVE ? "merge-pop" : mode == KMERGE_HEAP ? "merge-heap" : "merge-loser",
+           "runs", n, n * reps, elapsed, comparisons);
+}
+
+/* Min or max by the sign of bench_order, flipped to unorder a whole heap */
+int bench_order = 1;
+int ordered(void* a, void* b)
+{
+    return bench_order * min(a, b);
+}
+
+/* Heapify n elements laid out as a max heap into a min heap, on the
+ * given number of threads */
+void bench_heapify(int* values, void** data, size_t n, const char* dist, size_t threads)
+{
+    size_t reps = reps_for(n);
+    size_t comparisons = 0;
+    double elapsed = 0;
+
+    size_t r, i;
+    for (r = 0; r < reps; ++r) {
+        for (i = 0; i < n; ++i)
+            data[i] = &values[i];
+
+        binary_heap_t* heap;
+        bench_order = -1;
+        binary_heap_new_from_array(&heap, &ordered, data, n);
+        bench_order = 1;
+        size_t loaded = binary_heap_comparisons(heap);
+
+        double start = now_ns();
+        binary_heap_heapify_parallel(heap, threads);
+        elapsed += now_ns() - start;
+
+        comparisons += binary_heap_comparisons(heap) - loaded;
+        binary_heap_destroy(heap);
+    }
+
+    char name[16];
+    sprintf(name, "heapify-%lu", (unsigned long)threads);
+    report(name, dist, n, n * reps, elapsed, comparisons);
+}
+
+/* Neighbour of a node in an implicit random graph of degree 4 */
+size_t graph_edge(size_t node, size_t edge, size_t n, uint64_t* weight)
+{
+    unsigned long long x = (node * 4 + edge + 1) * 0x9E3779B97F4A7C15ULL;
+    x ^= x >> 31;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 29;
+
+    *weight = 1 + (x >> 40) % 1000;
+    return ((size_t)(x % n));
+}
+
+/* Dijkstra's algorithm from node 0 over a random graph with n nodes and
+ * 4n edges, on a keyed heap with decrease-key through handles */
+void bench_dijkstra(uint64_t* dist, binary_heap_handle_t* handles, size_t n)
+{
+    size_t reps = reps_for(n * 4);
+    size_t ops = 0;
+    size_t comparisons = 0;
+    double elapsed = 0;
+
+    size_t r, i;
+    for (r = 0; r < reps; ++r) {
+        for (i = 0; i < n; ++i) {
+            dist[i] = (uint64_t) - 1;
+            handles[i] = BINARY_HEAP_NO_HANDLE;
+        }
+
+        binary_heap_t* heap;
+        binary_heap_new_keyed(&heap);
+        binary_heap_track_handles(heap);
+
+        double start = now_ns();
+
+        dist[0] = 0;
+        handles[0] = binary_heap_push_key_handle(heap, 0, (void*)(size_t)0);
+        ++ops;
+
+        uint64_t key;
+        void* out;
+        while (binary_heap_peek_key(heap, &key)) {
+            binary_heap_pop(heap, &out);
+            ++ops;
+
+            size_t node = (size_t)out;
+            size_t edge;
+            for (edge = 0; edge < 4; ++edge) {
+                uint64_t weight;
+                size_t next = graph_edge(node, edge, n, &weight);
+                if (key + weight >= dist[next])
+                    continue;
+
+                dist[next] = key + weight;
+                if (handles[next] != BINARY_HEAP_NO_HANDLE && binary_heap_contains(heap, handles[next]))
+                    binary_heap_update_key(heap, handles[next], dist[next]);
+                else
+                    handles[next] = binary_heap_push_key_handle(heap, dist[next], (void*)next);
+                ++ops;
+            }
+        }
+
+        elapsed += now_ns() - start;
+
+        comparisons += binary_heap_comparisons(heap);
+        binary_heap_destroy(heap);
+    }
+
+    report("dijkstra", "graph", n, ops, elapsed, comparisons);
+}
+
+int main(int argc, char** argv)
+{
+    size_t max_n = (argc > 1 ? (size_t)strtod(argv[1], NULL) : 1000000);
+    const char* only = (argc > 2 ? argv[2] : NULL);
+    if (max_n < 100)
+        return 1;
+
+    int* values = (int*)malloc(max_n * sizeof(int));
+    void** data = (void**)malloc(max_n * sizeof(void*));
+    if (!values || !data)
+        return 1;
+
+    size_t n;
+    int d;
+    for (n = 100; n <= max_n; n *= 10) {
+        for (d = 0; d < DIST_COUNT; ++d) {
+            fill_values(values, n, d);
+            if (!only || !strcmp(only, "push"))
+                bench_push(values, n, dist_names[d]);
+            if (!only || !strcmp(only, "pop"))
+                bench_pop(values, data, n, dist_names[d]);
+            if (!only || !strcmp(only, "pop-keyed"))
+                bench_pop_keyed(values, n, dist_names[d], 1);
+            if (!only || !strcmp(only, "pop-scalar"))
+                bench_pop_keyed(values, n, dist_names[d], 0);
+            if (!only || !strcmp(only, "mix"))
+                bench_mix(values, n, dist_names[d]);
+            if (!only || !strcmp(only, "hold"))
+                bench_hold(values, data, n, dist_names[d], 0);
+            if (!only || !strcmp(only, "hold-fused"))
+                bench_hold(values, data, n, dist_names[d], 1);
+            if (!only || !strcmp(only, "heapify")) {
+                size_t threads;
+                for (threads = 1; threads <= 8; threads *= 2)
+                    bench_heapify(values, data, n, dist_names[d], threads);
+            }
+            if (!only || !strcmp(only, "monotone"))
+                bench_monotone(values, n, dist_names[d], 0);
+            if (!only || !strcmp(only, "mono-radix"))
+                bench_monotone(values, n, dist_names[d], 1);
+        }
+
+        /* Reuses the data array as the runs and their sources */
+        if (!only || !strcmp(only, "merge-pop"))
+            bench_kmerge(values, (bench_run_t*)data, data + max_n / 2, n, BENCH_MERGE_NAIVE);
+        if (!only || !strcmp(only, "merge-heap"))
+            bench_kmerge(values, (bench_run_t*)data, data + max_n / 2, n, KMERGE_HEAP);
+        if (!only || !strcmp(only, "merge-loser"))
+            bench_kmerge(values, (bench_run_t*)data, data + max_n / 2, n, KMERGE_LOSER_TREE);
+
+        /* Reuses the value and data arrays as distances and handles */
+        if (!only || !strcmp(only, "dijkstra")) {
+            uint64_t* dist = (uint64_t*)malloc(n * sizeof(uint64_t));
+            if (dist)
+                bench_dijkstra(dist, (binary_heap_handle_t*)data, n);
+            free(dist);
+        }
+    }
+
+    free(values);
+    free(data);
+    return 0;
+}
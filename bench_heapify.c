@@ -0,0 +1,131 @@
+/*
+ * bench_heapify.c
+ * Copyleft (C) 2016-2017 Chad Mowery
+ *
+ *
+ * bench_heapify.c is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bench_heapify.c is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "binaryheap.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+/* NOTE: Build with BINARY_HEAP_THREADS=1, see `make bench_heapify`
+ *
+ * Heapifies n random elements laid out as a max heap into a min heap with
+ * binary_heap_heapify_parallel on 1, 2 and 4 threads and on one thread per
+ * online CPU, and reports the best of RUNS times for each along with the
+ * speedup over a single thread.
+ *
+ * Usage: ./bench_heapify [n] [max threads] */
+
+#define RUNS 5
+
+/* Bench comparitor, a min heap when order is 1 and a max heap when -1 */
+int order = 1;
+int ordered(void* a, void* b)
+{
+    return order * ((*(int*)a > *(int*)b) - (*(int*)a < *(int*)b));
+}
+
+/* Bench helpers */
+double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Best of RUNS heapifies of the same elements on the given threads, in ns */
+double bench(int* values, void** data, size_t n, size_t threads)
+{
+    double best = 0;
+
+    int r;
+    for (r = 0; r < RUNS; ++r) {
+        size_t i;
+        for (i = 0; i < n; ++i)
+            data[i] = &values[i];
+
+        /* Laid out as a max heap, so every subtree has to be redone */
+        binary_heap_t* heap;
+        order = -1;
+        binary_heap_new_from_array(&heap, &ordered, data, n);
+        order = 1;
+
+        double start = now_ns();
+        binary_heap_heapify_parallel(heap, threads);
+        double elapsed = now_ns() - start;
+
+        binary_heap_destroy(heap);
+        if (r == 0 || elapsed < best)
+            best = elapsed;
+    }
+
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = (argc > 1 ? (size_t)strtod(argv[1], NULL) : 10000000);
+    long cpus = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    size_t max_threads = (argc > 2 ? (size_t)atoi(argv[2]) : (size_t)(cpus > 4 ? cpus : 4));
+    if (n < 1 || max_threads < 1)
+        return 1;
+
+    int* values = (int*)malloc(n * sizeof(int));
+    void** data = (void**)malloc(n * sizeof(void*));
+    if (!values || !data)
+        return 1;
+
+    unsigned long long rng = 88172645463325252ULL;
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        values[i] = (int)(rng & 0x7fffffff);
+    }
+
+    printf("heapify_parallel n=%lu, %ld online CPUs\n", (unsigned long)n, cpus);
+
+    double single = 0;
+    size_t threads = 1;
+    while (threads <= max_threads) {
+        double elapsed = bench(values, data, n, threads);
+        if (threads == 1)
+            single = elapsed;
+
+        printf("threads=%-3lu %10.2f ms %8.1f ns/elem %6.2fx speedup\n",
+               (unsigned long)threads, elapsed / 1e6, elapsed / (double)n, single / elapsed);
+
+        /* 1, 2, 4, then straight to max threads */
+        if (threads < 4 && threads * 2 <= max_threads)
+            threads *= 2;
+        else if (threads < max_threads)
+            threads = max_threads;
+        else
+            break;
+    }
+
+    free(values);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * bench_hpp.cpp
+ * Copyleft (C) 2016-2017 Chad Mowery
+ *
+ *
+ * bench_hpp.cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bench_hpp.cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "binaryheap.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <vector>
+
+/* Compares binaryheap::binary_heap against std::priority_queue, both as
+ * min heaps of ints, pushing n random values then popping them all. */
+
+static unsigned long long rng_state = 88172645463325252ULL;
+static unsigned long long rng_next()
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_ns()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const char* name, std::size_t n, double elapsed)
+{
+    std::printf("%-24s n=%-9lu %8.1f ns/op\n", name, (unsigned long)n, elapsed / (double)(2 * n));
+}
+
+int main()
+{
+    const std::size_t sizes[3] = { 100000, 1000000, 10000000 };
+
+    std::vector<int> values(sizes[2]);
+    for (std::size_t i = 0; i < values.size(); ++i)
+        values[i] = (int)(rng_next() & 0x7fffffff);
+
+    long long checksum = 0;
+    for (std::size_t s = 0; s < 3; ++s) {
+        std::size_t n = sizes[s];
+
+        double start = now_ns();
+        binaryheap::binary_heap<int> heap;
+        for (std::size_t i = 0; i < n; ++i)
+            heap.push(values[i]);
+        while (!heap.empty()) {
+            checksum += heap.top();
+            heap.pop();
+        }
+        report("binaryheap::binary_heap", n, now_ns() - start);
+
+        start = now_ns();
+        std::priority_queue<int, std::vector<int>, std::greater<int> > pq;
+        for (std::size_t i = 0; i < n; ++i)
+            pq.push(values[i]);
+        while (!pq.empty()) {
+            checksum -= pq.top();
+            pq.pop();
+        }
+        report("std::priority_queue", n, now_ns() - start);
+    }
+
+    /* Both drained the same values, keeps the loops from being optimized out */
+    return checksum != 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * bench_mq.c
+ * Copyleft (C) 2016-2017 Chad Mowery
+ *
+ *
+ * bench_mq.c is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * bench_mq.c is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "binaryheap.h"
+#include "multiqueue.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Threads alternate push and pop on a queue prefilled with PREFILL
+ * elements, once on a binary_heap_t behind a single mutex and once on a
+ * multiqueue with SHARDS_PER_THREAD shards per thread.
+ *
+ * Usage: ./bench_mq [max threads] */
+
+#define PREFILL           1000000
+#define OPS_PER_THREAD    1000000
+#define SHARDS_PER_THREAD 4
+
+/* Bench comparitor */
+int min(void* a, void* b)
+{
+    return (*(int*)a > *(int*)b) - (*(int*)a < *(int*)b);
+}
+
+/* Bench helpers */
+double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void report(const char* queue, int threads, double elapsed)
+{
+    double ops = (double)threads * OPS_PER_THREAD;
+    printf("%-12s threads=%-3d %8.2f Mops/s %8.1f ns/op\n", queue, threads, ops * 1e3 / elapsed, elapsed / ops);
+}
+
+/* Shared state of one run */
+typedef struct bench_queue {
+    binary_heap_t*  heap;
+    pthread_mutex_t lock;
+    multiqueue_t*   mq;
+    int*            values;
+} bench_queue_t;
+
+typedef struct bench_thread {
+    bench_queue_t* queue;
+    multiqueue_rng_t rng;
+} bench_thread_t;
+
+void* run_locked(void* arg)
+{
+    bench_thread_t* thread = (bench_thread_t*)arg;
+    bench_queue_t* queue = thread->queue;
+
+    void* out;
+    size_t i;
+    for (i = 0; i < OPS_PER_THREAD / 2; ++i) {
+        pthread_mutex_lock(&queue->lock);
+        binary_heap_pop(queue->heap, &out);
+        pthread_mutex_unlock(&queue->lock);
+
+        pthread_mutex_lock(&queue->lock);
+        binary_heap_push(queue->heap, out);
+        pthread_mutex_unlock(&queue->lock);
+    }
+
+    return NULL;
+}
+
+void* run_multiqueue(void* arg)
+{
+    bench_thread_t* thread = (bench_thread_t*)arg;
+    bench_queue_t* queue = thread->queue;
+
+    void* out;
+    size_t i;
+    for (i = 0; i < OPS_PER_THREAD / 2; ++i) {
+        multiqueue_pop(queue->mq, &out, &thread->rng);
+        multiqueue_push(queue->mq, out, &thread->rng);
+    }
+
+    return NULL;
+}
+
+void bench(bench_queue_t* queue, int threads, void* (*run)(void*), const char* name)
+{
+    pthread_t ids[256];
+    bench_thread_t state[256];
+
+    double start = now_ns();
+
+    int t;
+    for (t = 0; t < threads; ++t) {
+        state[t].queue = queue;
+        state[t].rng = (multiqueue_rng_t)t * 0x9E3779B97F4A7C15ULL + 1;
+        pthread_create(&ids[t], NULL, run, &state[t]);
+    }
+    for (t = 0; t < threads; ++t)
+        pthread_join(ids[t], NULL);
+
+    report(name, threads, now_ns() - start);
+}
+
+int main(int argc, char** argv)
+{
+    int max_threads = (argc > 1 ? atoi(argv[1]) : 8);
+    if (max_threads < 1 || max_threads > 256)
+        return 1;
+
+    bench_queue_t queue;
+    queue.values = (int*)malloc(PREFILL * sizeof(int));
+    if (!queue.values)
+        return 1;
+
+    multiqueue_rng_t rng = 88172645463325252ULL;
+    size_t i;
+    for (i = 0; i < PREFILL; ++i) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        queue.values[i] = (int)(rng & 0x7fffffff);
+    }
+
+    int threads;
+    for (threads = 1; threads <= max_threads; threads *= 2) {
+        binary_heap_new(&queue.heap, &min);
+        pthread_mutex_init(&queue.lock, NULL);
+        for (i = 0; i < PREFILL; ++i)
+            binary_heap_push(queue.heap, &queue.values[i]);
+
+        bench(&queue, threads, &run_locked, "single-lock");
+
+        pthread_mutex_destroy(&queue.lock);
+        binary_heap_destroy(queue.heap);
+
+        multiqueue_new(&queue.mq, &min, (size_t)(threads * SHARDS_PER_THREAD));
+        for (i = 0; i < PREFILL; ++i)
+            multiqueue_push(queue.mq, &queue.values[i], &rng);
+
+        bench(&queue, threads, &run_multiqueue, "multiqueue");
+
+        multiqueue_destroy(queue.mq);
+    }
+
+    free(queue.values);
+    return 0;
+}
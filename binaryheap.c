@@ -16,6 +16,9 @@
  * You should have received a copy of the GNU Lesser General Public License
  * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
  */
+/* For mmap in binary_heap_load */
+#define _POSIX_C_SOURCE 200112L
+
 #include "binaryheap.h"
 
 /* Uncomment to disable asserts
@@ -23,11 +26,158 @@
 #include <assert.h>
 
 #include <stdio.h>
+#include <string.h>
+
+/* SIMD child selection for keyed heaps, x86-64 with GCC or Clang only. Each
+ * group of 4 children is 64 bytes of entries, so groups are loaded whole
+ * and their keys unpacked from the payloads. */
+#if BINARY_HEAP_SIMD && BINARY_HEAP_ARITY % 4 == 0 && BINARY_HEAP_ARITY <= 16 && \
+    defined(__GNUC__) && defined(__x86_64__)
+#define HEAP_SIMD 1
+#include <immintrin.h>
+#else
+#define HEAP_SIMD 0
+#endif
+
+/* Heap files need mmap, save and load fail without it */
+#if defined(__unix__) || defined(__APPLE__)
+#define HEAP_FILES 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define HEAP_FILES 0
+#endif
+
+/* Parallel heapify, each thread gets at least HEAP_PARALLEL_MIN elements */
+#if BINARY_HEAP_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#define HEAP_PARALLEL_MIN 16384
+
+/* Child selection levels, best available first */
+#define HEAP_SIMD_NONE  0
+#define HEAP_SIMD_SSE42 1
+#define HEAP_SIMD_AVX2  2
 
 /* Forware declarations */
 void bubble_up  (binary_heap_t* heap, size_t index);
 void bubble_down(binary_heap_t* heap, size_t index);
-int  resize     (binary_heap_t* heap);
+void bubble_down_bottom_up(binary_heap_t* heap, size_t index);
+void sink_held  (binary_heap_t* heap, size_t index);
+void sink_held_bottom_up(binary_heap_t* heap, size_t index);
+size_t best_child(binary_heap_t* heap, size_t index);
+int  simd_level (void);
+#if HEAP_SIMD
+size_t best_key_avx2 (const void* children);
+size_t best_key_sse42(const void* children);
+#endif
+void pop_root   (binary_heap_t* heap);
+void replace_root(binary_heap_t* heap, const unsigned char* src);
+int  offer_slot (binary_heap_t* heap, const unsigned char* src, void** evicted);
+int  pushpop_slot(binary_heap_t* heap, const unsigned char* src, void** out);
+void remove_at  (binary_heap_t* heap, size_t index);
+void* drain     (binary_heap_t* heap, size_t k, size_t* count);
+void sort_storage(binary_heap_t* heap, size_t k);
+int  element_less(binary_heap_t* heap, const unsigned char* a, const unsigned char* b);
+int  element_order(const binary_heap_t* heap, const unsigned char* a, const unsigned char* b);
+void element_move(binary_heap_t* heap, unsigned char* dst, const unsigned char* src);
+void hold_element (binary_heap_t* heap, size_t index);
+void shift_element(binary_heap_t* heap, size_t dst, size_t src);
+void place_held   (binary_heap_t* heap, size_t index);
+binary_heap_handle_t next_handle(binary_heap_t* heap);
+void track_push (binary_heap_t* heap, size_t index);
+void resift     (binary_heap_t* heap, size_t index);
+void* element   (binary_heap_t* heap, size_t index);
+binary_heap_t* create(compare_f cmp, int kind, size_t elem_size, size_t capacity,
+                      const binary_heap_allocator_t* allocator, void* ctx);
+int  push_keyed (binary_heap_t* heap, uint64_t key, double dkey, void* payload);
+size_t radix_bucket(uint64_t key, uint64_t last);
+int  radix_reserve(binary_heap_t* heap, size_t bucket, size_t count);
+int  radix_push (binary_heap_t* heap, uint64_t key, void* payload);
+int  radix_pop  (binary_heap_t* heap, void** out);
+int  radix_settle(binary_heap_t* heap);
+void skip_dead  (binary_heap_t* heap);
+int  frontier_reserve(binary_heap_iter_t* iter, size_t count);
+void frontier_push(binary_heap_iter_t* iter, size_t index);
+size_t frontier_pop(binary_heap_iter_t* iter);
+size_t file_data_offset(size_t elem_size);
+int  unmap_storage(binary_heap_t* heap, size_t capacity);
+void compact    (binary_heap_t* heap);
+int  reserve    (binary_heap_t* heap, size_t count);
+int  reserve_grow(binary_heap_t* heap, size_t needed);
+int  prefer_heapify(size_t size, size_t count);
+void order_appended(binary_heap_t* heap, size_t first);
+int  storage_grow (binary_heap_t* heap, size_t capacity);
+void record_sift  (binary_heap_t* heap, size_t from, size_t to);
+void* heap_alloc  (binary_heap_t* heap, size_t size);
+void* heap_realloc(binary_heap_t* heap, void* ptr, size_t old_size, size_t new_size);
+void  heap_free   (binary_heap_t* heap, void* ptr, size_t size);
+void* default_alloc  (void* ctx, size_t size);
+void* default_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size);
+void  default_free   (void* ctx, void* ptr, size_t size);
+void  heapify_range  (binary_heap_t* heap, size_t first, size_t last);
+void* heapify_worker (void* arg);
+
+/* Heap storage kinds */
+#define HEAP_POINTERS    0
+#define HEAP_VALUES      1
+#define HEAP_KEYS        2
+#define HEAP_KEYS_DOUBLE 3
+#define HEAP_RADIX       4
+
+/**
+ * Entry stored by keyed heaps. Sifting compares the cached key directly
+ * and never calls a comparitor or touches the payload.
+ */
+typedef struct heap_entry
+{
+    union
+    {
+        uint64_t u;
+        double   d;
+    } key;
+
+    void* payload;
+} heap_entry_t;
+
+/* One bucket for keys equal to the last popped key, then one per bit of
+ * the highest bit in which a key differs from it */
+#define HEAP_RADIX_BUCKETS 65
+
+/**
+ * Buckets of a radix heap. Bucket b > 0 holds the entries whose key first
+ * differs from last at bit b - 1, bucket 0 those whose key equals last.
+ * Keys never go below last, so bucket 0 is always the top.
+ */
+typedef struct heap_radix
+{
+    uint64_t      last;
+    heap_entry_t* buckets[HEAP_RADIX_BUCKETS];
+    size_t        counts[HEAP_RADIX_BUCKETS];
+    size_t        capacities[HEAP_RADIX_BUCKETS];
+} heap_radix_t;
+
+/* Heap file format, version 1. The header is followed by padding up to
+ * data_offset, then size elements in heap order. Fields are in the byte
+ * order of the machine that saved the file, checked with byte_order. */
+#define HEAP_FILE_MAGIC   "BINHEAP"
+#define HEAP_FILE_VERSION 1
+#define HEAP_FILE_ORDER   0x01020304
+
+typedef struct heap_file_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t arity;
+    uint32_t reserved;
+    uint64_t elem_size;
+    uint64_t size;
+    uint64_t data_offset;
+} heap_file_header_t;
 
 /**
  * Binary heap object used to store heap state.
@@ -36,14 +186,143 @@ struct binary_heap
 {
     compare_f cmp;
 
-    void** data;
+    /* Element storage, offset into the allocated block for alignment.
+     * Loaded heaps map the file as their block until they first grow. */
+    unsigned char* data;
+    void*          block;
+    size_t         block_size;
+    int            mapped;
+
+    /* Allocator for all heap state, including the heap object itself */
+    const binary_heap_allocator_t* allocator;
+    void*                          allocator_ctx;
 
     size_t size;
     size_t capacity;
+
+    /* Pointer heaps store void* elements and compare what they point at.
+     * Sized heaps store elem_size byte elements by value. Keyed heaps store
+     * heap_entry_t elements and compare their keys. Radix heaps store
+     * heap_entry_t elements in radix buckets instead of data. */
+    size_t elem_size;
+    int    kind;
+
+    /* Room for the one element a sift holds outside the array. Sized
+     * heaps allocate it, other heaps point it at held. */
+    void*  scratch;
+    union
+    {
+        void*        ptr;
+        heap_entry_t entry;
+    } held;
+
+    /* Pop with bottom-up sifts instead of top-down ones */
+    int    bottom_up;
+
+    /* HEAP_SIMD_* level used to pick among a full set of children */
+    int    simd;
+
+    /* Number of element comparisons made so far, with
+     * BINARY_HEAP_COUNT_COMPARISONS */
+    size_t comparisons;
+
+    /* Fixed capacity of a bounded heap, 0 if unbounded */
+    size_t bound;
+
+    /* Radix heap buckets, NULL unless a radix heap */
+    heap_radix_t* radix;
+
+    /* Lazy deletion, is_dead is NULL unless enabled. dead counts the
+     * cancelled elements still stored, compacting past compact_at * size */
+    dead_f is_dead;
+    size_t dead;
+    double compact_at;
+
+#if BINARY_HEAP_STATS
+    /* Everything but comparisons, counted above */
+    binary_heap_stats_t stats;
+    size_t              sift_start;
+#endif
+
+    /* Handle tracking, NULL unless enabled. positions maps a handle to
+     * its heap index and handles maps a heap index to its handle. Freed
+     * handles are stacked in handles[size, handle_count) for reuse. */
+    size_t*              positions;
+    binary_heap_handle_t* handles;
+    size_t               handle_count;
+    binary_heap_handle_t held_handle;
 };
 
+/**
+ * Ordered iterator state. frontier is a binary min heap of indices into
+ * the iterated heap, ordered by the elements stored at them.
+ */
+struct binary_heap_iter
+{
+    binary_heap_t* heap;
+
+    size_t* frontier;
+    size_t  size;
+    size_t  capacity;
+};
+
+/**
+ * Share of a parallel heapify: the subtrees under level roots
+ * [first, last). view is a copy of the heap sharing its storage, with its
+ * own held element and counters, so workers never write the same memory.
+ */
+typedef struct heap_worker
+{
+    binary_heap_t view;
+    size_t        first;
+    size_t        last;
+#if BINARY_HEAP_THREADS
+    pthread_t     thread;
+    int           started;
+#endif
+} heap_worker_t;
+
+/* Address of the element stored at index i */
+#define HEAP_SLOT(heap, i) ((heap)->data + (i) * (heap)->elem_size)
+
+/* The data element stored at index i of a pointer heap */
+#define HEAP_PTR(heap, i)  (((void**)(heap)->data)[i])
+
+/* The entry stored at index i of a keyed heap */
+#define HEAP_ENTRY(heap, i) (((heap_entry_t*)(heap)->data)[i])
+
+/* Index math for a BINARY_HEAP_ARITY-ary heap */
+#define HEAP_PARENT(i)      (((i) - 1) / BINARY_HEAP_ARITY)
+#define HEAP_FIRST_CHILD(i) ((i) * BINARY_HEAP_ARITY + 1)
+
+/* Storage is aligned so the children of a node start on a cache line */
+#define HEAP_CACHE_LINE 64
+
+/* Stats hooks, nothing at all unless built with BINARY_HEAP_STATS */
+#if BINARY_HEAP_STATS
+#define HEAP_STAT_ADD(heap, field, n)     ((heap)->stats.field += (n))
+#define HEAP_STAT_MAX(heap, field, n)     ((heap)->stats.field < (n) ? (void)((heap)->stats.field = (n)) : (void)0)
+#define HEAP_STAT_SIFT_START(heap, index) ((heap)->sift_start = (index))
+#define HEAP_STAT_SIFT_END(heap, index)   record_sift((heap), (heap)->sift_start, (index))
+#else
+#define HEAP_STAT_ADD(heap, field, n)     ((void)0)
+#define HEAP_STAT_MAX(heap, field, n)     ((void)0)
+#define HEAP_STAT_SIFT_START(heap, index) ((void)0)
+#define HEAP_STAT_SIFT_END(heap, index)   ((void)0)
+#endif
+
+/* Comparison counting, nothing unless built with BINARY_HEAP_COUNT_COMPARISONS */
+#if BINARY_HEAP_COUNT_COMPARISONS
+#define HEAP_COUNT_COMPARISONS(heap, n) ((heap)->comparisons += (n))
+#else
+#define HEAP_COUNT_COMPARISONS(heap, n) ((void)0)
+#endif
+
 size_t HEAP_CAPACITY_MAX = (size_t) - 1;
 
+/* Allocator used unless one is given, wraps BINARY_HEAP_ALLOC et al. */
+const binary_heap_allocator_t HEAP_DEFAULT_ALLOCATOR = { &default_alloc, &default_realloc, &default_free };
+
 
 /**
  * Construct a new binary heap object. Binary heaps can used as either
@@ -56,25 +335,373 @@ void binary_heap_new(binary_heap_t** out, compare_f cmp)
 {
     assert(cmp);
 
-    binary_heap_t* heap = (binary_heap_t*)BINARY_HEAP_ALLOC(sizeof(binary_heap_t));
+    binary_heap_t* heap = create(cmp, HEAP_POINTERS, sizeof(void*), BINARY_HEAP_INITIAL_CAPACITY, &HEAP_DEFAULT_ALLOCATOR, NULL);
+    if (!heap)
+        return;
+
+    *out = heap;
+}
 
-    assert(heap);
+/**
+ * Construct a new binary heap object that gets all of its memory, the
+ * heap object included, from the given allocator instead of
+ * BINARY_HEAP_ALLOC. Elements are still freed by binary_heap_destroy_free
+ * with BINARY_HEAP_FREE, since the caller allocated them.
+ *
+ * @param[out] out       The out pointer to hold the new binary_heap_t object
+ * @param[in]  cmp       The comparitor function pointer
+ * @param[in]  allocator The allocator, which must outlive the heap
+ * @param[in]  ctx       The context passed to every allocator call
+ */
+void binary_heap_new_with_allocator(binary_heap_t** out, compare_f cmp, const binary_heap_allocator_t* allocator, void* ctx)
+{
+    assert(cmp);
+    assert(allocator);
+    assert(allocator->alloc && allocator->realloc && allocator->free);
+
+    binary_heap_t* heap = create(cmp, HEAP_POINTERS, sizeof(void*), BINARY_HEAP_INITIAL_CAPACITY, allocator, ctx);
+    if (!heap)
+        return;
+
+    *out = heap;
+}
+
+/**
+ * Construct a new sized binary heap object. Sized heaps store fixed size
+ * elements by value in one contiguous array instead of storing pointers,
+ * so sifting never chases pointers and nothing is allocated per element.
+ * Elements are copied in by binary_heap_push_value and copied out by
+ * binary_heap_pop_value. The comparitor receives pointers to two stored
+ * elements.
+ *
+ * @param[out] out       The out pointer to hold the new binary_heap_t object
+ * @param[in]  elem_size The size in bytes of a single element
+ * @param[in]  cmp       The comparitor function pointer
+ */
+void binary_heap_new_sized(binary_heap_t** out, size_t elem_size, compare_f cmp)
+{
+    assert(cmp);
+    assert(elem_size > 0);
+
+    binary_heap_t* heap = create(cmp, HEAP_VALUES, elem_size, BINARY_HEAP_INITIAL_CAPACITY, &HEAP_DEFAULT_ALLOCATOR, NULL);
+    if (!heap)
+        return;
+
+    *out = heap;
+}
+
+/**
+ * Construct a new keyed binary heap object. Keyed heaps store an unsigned
+ * 64-bit key next to each data element and order elements by smallest key
+ * first, comparing the keys directly instead of calling a comparitor.
+ * Elements are added with binary_heap_push_key and removed with the regular
+ * binary_heap_pop and binary_heap_peek. For largest-first ordering store
+ * inverted keys (UINT64_MAX - key).
+ *
+ * @param[out] out  The out pointer to hold the new binary_heap_t object
+ */
+void binary_heap_new_keyed(binary_heap_t** out)
+{
+    binary_heap_t* heap = create(NULL, HEAP_KEYS, sizeof(heap_entry_t), BINARY_HEAP_INITIAL_CAPACITY, &HEAP_DEFAULT_ALLOCATOR, NULL);
     if (!heap)
         return;
 
-    heap->data = BINARY_HEAP_ALLOC(BINARY_HEAP_INITIAL_CAPACITY * sizeof(void*));
+    *out = heap;
+}
+
+/**
+ * Construct a new radix heap object, a keyed heap engine for monotone
+ * priorities, where no key is ever pushed below the last popped key, such
+ * as event times in a simulation or distances in Dijkstra's algorithm.
+ * Entries sit in 65 buckets by the highest bit where their key differs
+ * from the last popped key, and a pop only sorts out the lowest non-empty
+ * bucket, which moves each entry at most 64 times over its life. Pushes
+ * are O(1), pops amortized O(log C) for keys spanning a range of C, and no
+ * sift ever runs.
+ *
+ * Radix heaps use the keyed heap calls binary_heap_push_key,
+ * binary_heap_peek_key, binary_heap_pop, binary_heap_pop_n and
+ * binary_heap_peek, plus size, capacity, traverse and destroy. Entries
+ * with equal keys pop in no particular order. Buckets grow on demand, even
+ * with BINARY_HEAP_RESIZE set to 0.
+ *
+ * @param[out] out  The out pointer to hold the new binary_heap_t object
+ */
+void binary_heap_new_radix(binary_heap_t** out)
+{
+    binary_heap_t* heap = create(NULL, HEAP_RADIX, sizeof(heap_entry_t), 0, &HEAP_DEFAULT_ALLOCATOR, NULL);
+    if (!heap)
+        return;
 
-    assert(heap->data);
-    if (!heap->data) {
+    heap->radix = (heap_radix_t*)heap_alloc(heap, sizeof(heap_radix_t));
+    assert(heap->radix);
+    if (!heap->radix) {
         binary_heap_destroy(heap);
         return;
     }
 
-    heap->cmp = cmp;
-    heap->size   = 0;
-    heap->capacity = BINARY_HEAP_INITIAL_CAPACITY;
+    memset(heap->radix, 0, sizeof(heap_radix_t));
+    *out = heap;
+}
+
+/**
+ * Construct a new bounded binary heap object that keeps at most k elements,
+ * for streaming top-k selection. Storage for k elements is allocated once
+ * and never grows, pushes past k fail. binary_heap_offer keeps the k
+ * elements that compare last, so a min heap comparitor keeps the k
+ * largest, and the root is always the next element to be evicted.
+ *
+ * @param[out] out  The out pointer to hold the new binary_heap_t object
+ * @param[in]  cmp  The comparitor function pointer
+ * @param[in]  k    The number of elements to keep
+ */
+void binary_heap_new_bounded(binary_heap_t** out, compare_f cmp, size_t k)
+{
+    assert(cmp);
+    assert(k > 0);
+
+    binary_heap_t* heap = create(cmp, HEAP_POINTERS, sizeof(void*), k, &HEAP_DEFAULT_ALLOCATOR, NULL);
+    if (!heap)
+        return;
+
+    heap->bound = k;
+    *out = heap;
+}
+
+/**
+ * Construct a new bounded keyed binary heap object that keeps the k
+ * elements with the largest keys. See binary_heap_new_bounded.
+ *
+ * @param[out] out  The out pointer to hold the new binary_heap_t object
+ * @param[in]  k    The number of elements to keep
+ */
+void binary_heap_new_keyed_bounded(binary_heap_t** out, size_t k)
+{
+    assert(k > 0);
+
+    binary_heap_t* heap = create(NULL, HEAP_KEYS, sizeof(heap_entry_t), k, &HEAP_DEFAULT_ALLOCATOR, NULL);
+    if (!heap)
+        return;
+
+    heap->bound = k;
+    *out = heap;
+}
+
+/**
+ * Construct a new keyed binary heap object ordered by smallest double key
+ * first. Elements are added with binary_heap_push_key_double. Keys must not
+ * be NaN. For largest-first ordering store negated keys.
+ *
+ * @param[out] out  The out pointer to hold the new binary_heap_t object
+ */
+void binary_heap_new_keyed_double(binary_heap_t** out)
+{
+    binary_heap_t* heap = create(NULL, HEAP_KEYS_DOUBLE, sizeof(heap_entry_t), BINARY_HEAP_INITIAL_CAPACITY, &HEAP_DEFAULT_ALLOCATOR, NULL);
+    if (!heap)
+        return;
+
+    *out = heap;
+}
+
+/**
+ * Construct a new binary heap object from an existing array of data
+ * elements. The elements are copied into storage sized once for the whole
+ * array and ordered with a bottom-up heapify, which is much cheaper than
+ * pushing them one at a time. The caller keeps ownership of the array.
+ * O(n)
+ *
+ * @param[out] out  The out pointer to hold the new binary_heap_t object
+ * @param[in]  cmp  The comparitor function pointer
+ * @param[in]  data The array of data elements to copy
+ * @param[in]  size The number of elements in the array
+ */
+void binary_heap_new_from_array(binary_heap_t** out, compare_f cmp, void** data, size_t size)
+{
+    assert(cmp);
+    assert(data || size == 0);
+
+    binary_heap_t* heap = create(cmp, HEAP_POINTERS, sizeof(void*), size > BINARY_HEAP_INITIAL_CAPACITY ? size : BINARY_HEAP_INITIAL_CAPACITY, &HEAP_DEFAULT_ALLOCATOR, NULL);
+    if (!heap)
+        return;
+
+    size_t i;
+    for (i = 0; i < size; ++i)
+        HEAP_PTR(heap, i) = data[i];
+    heap->size = size;
+    HEAP_STAT_MAX(heap, max_size, size);
+
+    binary_heap_heapify(heap);
+
+    *out = heap;
+}
+
+/**
+ * Construct a new binary heap object that takes ownership of an existing
+ * array of data elements, which is then heapified in place. The array must
+ * have been allocated with BINARY_HEAP_ALLOC, since the heap will resize and
+ * free it. If construction fails the array is left with the caller.
+ * O(n)
+ *
+ * @param[out] out      The out pointer to hold the new binary_heap_t object
+ * @param[in]  cmp      The comparitor function pointer
+ * @param[in]  data     The array of data elements to adopt
+ * @param[in]  size     The number of elements in the array
+ * @param[in]  capacity The number of elements the array has room for
+ */
+void binary_heap_adopt_array(binary_heap_t** out, compare_f cmp, void** data, size_t size, size_t capacity)
+{
+    assert(cmp);
+    assert(data);
+    assert(size <= capacity);
+    assert(capacity > 0);
+
+    binary_heap_t* heap = create(cmp, HEAP_POINTERS, sizeof(void*), 0, &HEAP_DEFAULT_ALLOCATOR, NULL);
+    if (!heap)
+        return;
+
+    heap->data = (unsigned char*)data;
+    heap->block = data;
+    heap->block_size = capacity * sizeof(void*);
+    HEAP_STAT_MAX(heap, max_size, size);
+    heap->size = size;
+    heap->capacity = capacity;
+
+    binary_heap_heapify(heap);
+
+    *out = heap;
+}
+
+/**
+ * Save a sized binary heap to a file, writing its elements as they are
+ * stored along with the element size and BINARY_HEAP_ARITY, so
+ * binary_heap_load can map them back without re-heapifying. Elements must
+ * not hold pointers that would be meaningless to the loading process.
+ * Writes to path.tmp, then renames it over path, so a crash never leaves a
+ * partial file at path. Drops cancelled elements first.
+ * O(n)
+ *
+ * @param[in] heap  The sized binary heap
+ * @param[in] path  The file to write
+ * @return          1 if the file is written, otherwise 0
+ */
+int binary_heap_save(binary_heap_t* heap, const char* path)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_VALUES);
+    assert(path);
+
+#if HEAP_FILES
+    if (heap->dead)
+        compact(heap);
+
+    size_t length = strlen(path);
+    char* tmp = (char*)heap_alloc(heap, length + 5);
+    if (!tmp)
+        return 0;
+    memcpy(tmp, path, length);
+    memcpy(tmp + length, ".tmp", 5);
+
+    heap_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HEAP_FILE_MAGIC, sizeof(HEAP_FILE_MAGIC));
+    header.version = HEAP_FILE_VERSION;
+    header.byte_order = HEAP_FILE_ORDER;
+    header.arity = BINARY_HEAP_ARITY;
+    header.elem_size = heap->elem_size;
+    header.size = heap->size;
+    header.data_offset = file_data_offset(heap->elem_size);
+
+    int success = 0;
+    FILE* file = fopen(tmp, "wb");
+    if (file) {
+        static const char padding[HEAP_CACHE_LINE];
+        size_t pad = header.data_offset - sizeof(header);
+        success = (fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   (pad == 0 || fwrite(padding, pad, 1, file) == 1) &&
+                   fwrite(heap->data, heap->elem_size, heap->size, file) == heap->size &&
+                   fflush(file) == 0 && fsync(fileno(file)) == 0);
+        success = (fclose(file) == 0 && success && rename(tmp, path) == 0);
+        if (!success)
+            remove(tmp);
+    }
+
+    heap_free(heap, tmp, length + 5);
+    return success;
+#else
+    (void)path;
+    return 0;
+#endif
+}
+
+/**
+ * Construct a sized binary heap object from a file written by
+ * binary_heap_save. The file is mapped copy-on-write and used as the heap's
+ * storage as it is, so loading only costs faulting in the pages that get
+ * touched, and changes to the heap never reach the file. The first push
+ * copies the elements into allocated storage, since the mapping cannot
+ * grow. Fails if the file was saved with another element size,
+ * BINARY_HEAP_ARITY, format version or byte order, or is truncated.
+ * O(1)
+ *
+ * @param[out] out          The out pointer to hold the new binary_heap_t object
+ * @param[in]  path         The file to load
+ * @param[in]  elem_size    The size in bytes of each element
+ * @param[in]  cmp          The comparitor the heap was saved with
+ * @return                  1 if the heap is loaded, otherwise 0
+ */
+int binary_heap_load(binary_heap_t** out, const char* path, size_t elem_size, compare_f cmp)
+{
+    assert(out);
+    assert(path);
+    assert(elem_size > 0);
+    assert(cmp);
+
+#if HEAP_FILES
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(heap_file_header_t))
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return 0;
+
+    size_t length = (size_t)st.st_size;
+    const heap_file_header_t* header = (const heap_file_header_t*)map;
+    if (memcmp(header->magic, HEAP_FILE_MAGIC, sizeof(HEAP_FILE_MAGIC)) != 0 ||
+        header->version != HEAP_FILE_VERSION || header->byte_order != HEAP_FILE_ORDER ||
+        header->arity != BINARY_HEAP_ARITY || header->elem_size != elem_size ||
+        header->data_offset != file_data_offset(elem_size) || header->data_offset > length ||
+        header->size > (length - header->data_offset) / elem_size) {
+        munmap(map, length);
+        return 0;
+    }
+
+    binary_heap_t* heap = create(cmp, HEAP_VALUES, elem_size, 0, &HEAP_DEFAULT_ALLOCATOR, NULL);
+    if (!heap) {
+        munmap(map, length);
+        return 0;
+    }
+
+    heap->block = map;
+    heap->block_size = length;
+    heap->mapped = 1;
+    heap->data = (unsigned char*)map + header->data_offset;
+    heap->size = (size_t)header->size;
+    heap->capacity = heap->size;
+    HEAP_STAT_MAX(heap, max_size, heap->size);
 
     *out = heap;
+    return 1;
+#else
+    (void)path;
+    (void)elem_size;
+    (void)cmp;
+    return 0;
+#endif
 }
 
 /**
@@ -87,13 +714,30 @@ void binary_heap_destroy(binary_heap_t* heap)
 {
     assert(heap);
 
-    BINARY_HEAP_FREE(heap->data);
-    BINARY_HEAP_FREE(heap);
+#if HEAP_FILES
+    if (heap->mapped)
+        munmap(heap->block, heap->block_size);
+    else
+#endif
+        heap_free(heap, heap->block, heap->block_size);
+    heap_free(heap, heap->positions, heap->capacity * sizeof(size_t));
+    heap_free(heap, heap->handles, heap->capacity * sizeof(binary_heap_handle_t));
+    if (heap->radix) {
+        size_t b;
+        for (b = 0; b < HEAP_RADIX_BUCKETS; ++b)
+            heap_free(heap, heap->radix->buckets[b], heap->radix->capacities[b] * sizeof(heap_entry_t));
+        heap_free(heap, heap->radix, sizeof(heap_radix_t));
+    }
+    if (heap->scratch != (void*)&heap->held)
+        heap_free(heap, heap->scratch, heap->elem_size);
+    heap_free(heap, heap, sizeof(binary_heap_t));
 }
 
 /**
  * Destroy a binary heap object. This operation will free internal heap state
- * AND free all heap data (void*).
+ * AND free all heap data (void*), which for keyed heaps are the payloads.
+ * Sized heaps own their elements, so this is the same as binary_heap_destroy
+ * for them.
  * 
  * @param[in] heap  The binary heap to destroy
  */
@@ -102,14 +746,21 @@ void binary_heap_destroy_free(binary_heap_t* heap)
     assert(heap);
 
     size_t i;
-    for (i = 0; i < heap->size; ++i)
-        BINARY_HEAP_FREE(heap->data[i]);
+    for (i = 0; i < heap->size && heap->kind != HEAP_VALUES && !heap->radix; ++i)
+        BINARY_HEAP_FREE(element(heap, i));
+
+    size_t b;
+    for (b = 0; heap->radix && b < HEAP_RADIX_BUCKETS; ++b) {
+        for (i = 0; i < heap->radix->counts[b]; ++i)
+            BINARY_HEAP_FREE(heap->radix->buckets[b][i].payload);
+    }
 
     binary_heap_destroy(heap);
 }
 
 /**
- * Get a binary heap size.
+ * Get a binary heap size. With lazy deletion, cancelled elements still
+ * waiting to be skipped or compacted away are not counted.
  * O(1)
  * 
  * @param[in] heap  The binary heap
@@ -118,7 +769,7 @@ void binary_heap_destroy_free(binary_heap_t* heap)
 size_t binary_heap_size(binary_heap_t* heap)
 {
     assert(heap);
-    return (heap->size);
+    return (heap->size - heap->dead);
 }
 
 /**
@@ -135,7 +786,10 @@ size_t binary_heap_capacity(binary_heap_t* heap)
 }
 
 /**
- * Traverse the entire binary heap in array order.
+ * Traverse the entire binary heap in array order. Sized heaps visit a
+ * pointer to each stored element, keyed heaps visit each payload. Radix
+ * heaps visit payloads bucket by bucket. See binary_heap_iter_new for
+ * priority order.
  * O(n)
  * 
  * @param[in] heap  The binary heap to traverse
@@ -149,182 +803,2549 @@ void binary_heap_traverse(binary_heap_t* heap, visit_f visit)
     if (!heap->size)
         return;
 
-    size_t i;
-    for (i = 0; i < heap->size; ++i)
-        visit(*(heap->data + i));
+    size_t i, b;
+    for (b = 0; heap->radix && b < HEAP_RADIX_BUCKETS; ++b) {
+        for (i = 0; i < heap->radix->counts[b]; ++i)
+            visit(heap->radix->buckets[b][i].payload);
+    }
+
+    for (i = 0; i < heap->size && !heap->radix; ++i)
+        visit(element(heap, i));
 }
 
 /**
- * Add a new data element to a binary heap.
- * O(logn)
- * 
- * @param[in] heap  The binary heap
- * @param[in] data  The data element to add
- * @return          1 if the add is successful, otherwise 0
+ * Create an iterator over a binary heap in priority order, without
+ * modifying it. The next element is always the root or a child of an
+ * element already visited, so only those candidates are kept, in a
+ * frontier heap of indices. Visiting the first k elements allocates
+ * O(k) and takes O(k logk), however large the heap. The heap must not be
+ * modified until the iterator is destroyed. Not for radix heaps.
+ * O(1)
+ *
+ * @param[out] out   The out ptr to the new iterator
+ * @param[in]  heap  The binary heap to iterate
+ * @param[in]  k     The number of elements expected to be visited, the frontier
+ *                   grows past it as needed, 0 for a small default
+ * @return           1 if the iterator is created, otherwise 0
  */
-int binary_heap_push(binary_heap_t* heap, void* data)
+int binary_heap_iter_new(binary_heap_iter_t** out, binary_heap_t* heap, size_t k)
 {
+    assert(out);
     assert(heap);
+    assert(!heap->radix);
 
-    /* Check for overflow */
-    if (heap->size + 1 == HEAP_CAPACITY_MAX)
+    *out = NULL;
+    binary_heap_iter_t* iter = (binary_heap_iter_t*)heap_alloc(heap, sizeof(binary_heap_iter_t));
+    if (!iter)
         return 0;
 
-    /* If we ran out of space attempt to grab some more */
-    if (heap->size == heap->capacity)
-    {
-        if (!resize(heap))
-            return 0;
+    iter->heap = heap;
+    iter->frontier = NULL;
+    iter->size = 0;
+    iter->capacity = 0;
+
+    /* Each visit swaps one index for at most BINARY_HEAP_ARITY children */
+    if (!frontier_reserve(iter, 1 + (k ? k : 8) * (BINARY_HEAP_ARITY - 1))) {
+        binary_heap_iter_destroy(iter);
+        return 0;
     }
 
-    /* Do the add then bubble up */
-    heap->data[heap->size++] = data;
-    bubble_up(heap, heap->size - 1);
+    if (heap->size > 0)
+        frontier_push(iter, 0);
 
+    *out = iter;
     return 1;
 }
 
 /**
- * Remove the top-most element from a binary heap. The top-most
- * element is guaranteed to be the smallest/largest in the heap
- * based on the user comparitor function. Removing elements from
- * binary heaps reduces their size by 1, but capacity remains unchanged.
- * O(logn)
- * 
- * @param[in]  heap The binary heap
- * @param[out] out  The out ptr to the removed data element
+ * Destroy an ordered iterator. The heap is left alone.
+ * O(1)
+ *
+ * @param[in] iter  The iterator
  */
-void binary_heap_pop(binary_heap_t* heap, void** out)
+void binary_heap_iter_destroy(binary_heap_iter_t* iter)
 {
-    assert(heap);
-
-    if (heap->size == 0)
-        return;
+    assert(iter);
 
-    *out = *heap->data;
-
-    /* Take the last element in the heap and bubble it down */
-    if (--heap->size > 0) {
-        *heap->data = heap->data[heap->size];
-        bubble_down(heap, 0);
-    }
+    binary_heap_t* heap = iter->heap;
+    heap_free(heap, iter->frontier, iter->capacity * sizeof(size_t));
+    heap_free(heap, iter, sizeof(binary_heap_iter_t));
 }
 
 /**
- * Peek at the top-most data element in a binary heap. The caller
- * should NOT modify it's data as it may invalidate the state of
- * the heap.
- * O(1)
- * 
- * @param[in]  heap    The binary heap
- * @param[out] out     The out ptr to the top-most element if exists, otherwise NULL
+ * Get the next element in priority order, the element binary_heap_peek
+ * would return after as many pops. Cancelled elements are skipped.
+ * O(logk) for the k-th element
+ *
+ * @param[in]  iter  The iterator
+ * @param[out] out   The out ptr to the next element, NULL once there are none
+ * @return           1 if there was a next element, otherwise 0 at the end or if the
+ *                   frontier could not grow
  */
-void binary_heap_peek(binary_heap_t* heap, void** out)
+int binary_heap_iter_next(binary_heap_iter_t* iter, void** out)
 {
-    assert(heap);
-    *out = (heap->size > 0 ? *heap->data : NULL);
-}
+    assert(iter);
+    assert(out);
 
+    binary_heap_t* heap = iter->heap;
+    *out = NULL;
 
-/* Internal Helpers */
+    while (iter->size > 0) {
+        if (!frontier_reserve(iter, iter->size - 1 + BINARY_HEAP_ARITY))
+            return 0;
 
-/**
- * Attempt to resize the binary heap. This operation fails if heap
- * resizes are not allowed via BINARY_HEAP_RESIZE 0, or if the new
- * heap capacity is greater than the size_t limit.
+        size_t index = frontier_pop(iter);
+        size_t child = HEAP_FIRST_CHILD(index);
+        size_t last = child + BINARY_HEAP_ARITY;
+        for (; child < last && child < heap->size; ++child)
+            frontier_push(iter, child);
+
+        void* data = element(heap, index);
+        if (heap->is_dead && heap->is_dead(data))
+            continue;
+
+        *out = data;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Add a new data element to a binary heap.
+ * O(logn)
  * 
  * @param[in] heap  The binary heap
- * @return          1 if resize success, otherwise 0
+ * @param[in] data  The data element to add
+ * @return          1 if the add is successful, otherwise 0
  */
-int resize(binary_heap_t* heap)
+int binary_heap_push(binary_heap_t* heap, void* data)
 {
-    size_t new_size = heap->capacity << 1;
-    /* Bail if resizing is not allowed or if the resize overflowed */
-    if (!BINARY_HEAP_RESIZE || (new_size < heap->capacity && new_size < HEAP_CAPACITY_MAX))
+    assert(heap);
+    assert(heap->kind == HEAP_POINTERS);
+
+    /* If we ran out of space attempt to grab some more. A failed grow
+     * leaves the heap as it was, which matters with bounded allocators */
+    if (!reserve(heap, 1))
         return 0;
 
-    heap->capacity = new_size;
+    /* Do the add then bubble up */
+    HEAP_PTR(heap, heap->size) = data;
+    track_push(heap, heap->size++);
+    bubble_up(heap, heap->size - 1);
+
+    return 1;
+}
 
-    void* new_data = BINARY_HEAP_REALLOC(heap->data, heap->capacity * sizeof(void*));
+/**
+ * Copy a new element into a sized binary heap.
+ * O(logn)
+ *
+ * @param[in] heap  The sized binary heap
+ * @param[in] elem  Pointer to the elem_size bytes to copy in
+ * @return          1 if the add is successful, otherwise 0
+ */
+int binary_heap_push_value(binary_heap_t* heap, const void* elem)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_VALUES);
+    assert(elem);
 
-    assert(new_data);
-    if (!new_data) {
-        /* When realloc fails, our entire block of memory is invalidated so 
-         * unfortunately, we must free it along with the entire heap */
-        binary_heap_destroy_free(heap);
+    if (!reserve(heap, 1))
         return 0;
-    }
 
-    heap->data = new_data;
+    memcpy(HEAP_SLOT(heap, heap->size++), elem, heap->elem_size);
+    bubble_up(heap, heap->size - 1);
 
     return 1;
 }
 
 /**
- * Recursively bubbles up data elements in a heap based on the user
- * comparitor function (min/max). The result of this operation is a
- * binary heap with its top-most element being the smallest/largest
- * in the heap.
+ * Add a new data element to a keyed binary heap. Radix heaps need key to
+ * be at least the last popped key.
+ * O(logn), O(1) for radix heaps
+ *
+ * @param[in] heap     The keyed binary heap
+ * @param[in] key      The priority of the element, smallest first
+ * @param[in] payload  The data element to add
+ * @return             1 if the add is successful, otherwise 0
+ */
+int binary_heap_push_key(binary_heap_t* heap, uint64_t key, void* payload)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_KEYS || heap->kind == HEAP_RADIX);
+
+    if (heap->radix)
+        return radix_push(heap, key, payload);
+
+    return push_keyed(heap, key, 0.0, payload);
+}
+
+/**
+ * Add a new data element to a double keyed binary heap.
+ * O(logn)
+ *
+ * @param[in] heap     The double keyed binary heap
+ * @param[in] key      The priority of the element, smallest first
+ * @param[in] payload  The data element to add
+ * @return             1 if the add is successful, otherwise 0
+ */
+int binary_heap_push_key_double(binary_heap_t* heap, double key, void* payload)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_KEYS_DOUBLE);
+    assert(key == key);
+
+    return push_keyed(heap, 0, key, payload);
+}
+
+/**
+ * Remove the top-most element from a binary heap. The top-most
+ * element is guaranteed to be the smallest/largest in the heap
+ * based on the user comparitor function. Removing elements from
+ * binary heaps reduces their size by 1, but capacity remains unchanged.
+ * Keyed heaps return the payload of the entry with the smallest key.
+ * O(logn)
  * 
- * @param[in] heap  The binary heap
- * @param[in] index The current heap index
+ * @param[in]  heap The binary heap
+ * @param[out] out  The out ptr to the removed data element
  */
-void bubble_up(binary_heap_t* heap, size_t index)
+void binary_heap_pop(binary_heap_t* heap, void** out)
 {
     assert(heap);
-    assert(index >= 0);
-    assert(index < heap->size);
+    assert(heap->kind != HEAP_VALUES);
+
+    if (heap->radix) {
+        radix_pop(heap, out);
+        return;
+    }
 
-    /* If we are at the root level, we are sorted */
-    if (index == 0)
+    skip_dead(heap);
+    if (heap->size == 0)
         return;
 
-    size_t parent_index = (index - 1) / 2;
+    *out = element(heap, 0);
+    pop_root(heap);
+}
+
+/**
+ * Remove the top-most element from a sized binary heap, copying it out.
+ * O(logn)
+ *
+ * @param[in]  heap The sized binary heap
+ * @param[out] out  Room for elem_size bytes to receive the removed element
+ * @return          1 if an element was removed, otherwise 0 if the heap is empty
+ */
+int binary_heap_pop_value(binary_heap_t* heap, void* out)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_VALUES);
+    assert(out);
+
+    skip_dead(heap);
+    if (heap->size == 0)
+        return 0;
+
+    memcpy(out, HEAP_SLOT(heap, 0), heap->elem_size);
+    pop_root(heap);
+
+    return 1;
+}
+
+/**
+ * Add a batch of data elements to a binary heap. Capacity is reserved once
+ * for the whole batch. Small batches are bubbled up one at a time, while
+ * batches that are large relative to the heap are appended and the whole
+ * heap is re-heapified, whichever needs fewer comparisons.
+ * O(k log(n + k)) or O(n + k)
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] data  The array of data elements to add
+ * @param[in] count The number of elements in the array
+ * @return          1 if the add is successful, otherwise 0 and the heap is unchanged
+ */
+int binary_heap_push_n(binary_heap_t* heap, void** data, size_t count)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_POINTERS);
+    assert(data || count == 0);
 
-    if (heap->cmp(heap->data[index], heap->data[parent_index]) < 0) {
-        void* tmp = heap->data[index];
-        heap->data[index] = heap->data[parent_index];
-        heap->data[parent_index] = tmp;
+    if (!reserve(heap, count))
+        return 0;
 
-        bubble_up(heap, parent_index);
+    size_t first = heap->size;
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        HEAP_PTR(heap, first + i) = data[i];
+        track_push(heap, heap->size++);
     }
+
+    order_appended(heap, first);
+
+    return 1;
 }
 
 /**
- * Recursively bubbles down data elements in a heap based on the user
- * comparitor function (min/max). The result of this operation is a
- * binary heap with its top-most element being the smallest/largest
- * in the heap.
- * 
+ * Move every element of src into dst, leaving src empty and reusable. Both
+ * heaps must be of the same kind, element size and comparitor. dst grows
+ * once, src's array is appended, and then the appended elements are
+ * bubbled up or the whole heap re-heapified, whichever needs fewer
+ * comparisons. With handle tracking, dst gives the moved elements new
+ * handles and all of src's handles become invalid.
+ * O(m log(n + m)) or O(n + m)
+ *
+ * @param[in] dst   The binary heap to merge into
+ * @param[in] src   The binary heap to empty
+ * @return          1 if the merge is successful, otherwise 0 and both heaps are unchanged
+ */
+int binary_heap_merge(binary_heap_t* dst, binary_heap_t* src)
+{
+    assert(dst);
+    assert(src);
+    assert(dst != src);
+    assert(dst->kind == src->kind);
+    assert(!dst->radix);
+    assert(dst->elem_size == src->elem_size);
+    assert(dst->cmp == src->cmp);
+    assert(!src->is_dead || src->is_dead == dst->is_dead);
+
+    /* Drained heaps have no storage to copy from */
+    if (src->size == 0)
+        return 1;
+
+    if (!reserve(dst, src->size))
+        return 0;
+
+    size_t first = dst->size;
+    memcpy(HEAP_SLOT(dst, first), src->data, src->size * src->elem_size);
+
+    size_t i;
+    for (i = 0; i < src->size; ++i)
+        track_push(dst, dst->size++);
+
+    dst->dead += src->dead;
+    src->size = 0;
+    src->dead = 0;
+    src->handle_count = 0;
+
+    order_appended(dst, first);
+
+    return 1;
+}
+
+/**
+ * Push a data element and then pop the top-most element, with at most a
+ * single sift down. If the heap is empty or data compares before or equal
+ * to the top it is handed straight back after one comparison. Otherwise
+ * the top is popped and data takes its place, and with handle tracking
+ * data takes over the popped element's handle.
+ * O(1) if data is handed back, otherwise O(logn)
+ *
+ * @param[in]  heap The binary heap
+ * @param[in]  data The data element to add
+ * @param[out] out  The out ptr to the removed data element, data itself or the old top
+ * @return          1 if data was added to the heap, otherwise 0
+ */
+int binary_heap_pushpop(binary_heap_t* heap, void* data, void** out)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_POINTERS);
+    assert(out);
+
+    *out = data;
+    return (pushpop_slot(heap, (const unsigned char*)&data, out));
+}
+
+/**
+ * Pop the top-most element and push a data element, with a single sift
+ * down. Unlike binary_heap_pushpop data is added even if it belongs at the
+ * top. With handle tracking data takes over the popped element's handle.
+ * An empty heap is left unchanged.
+ * O(logn)
+ *
+ * @param[in]  heap The binary heap
+ * @param[in]  data The data element to add
+ * @param[out] out  The out ptr to the removed data element
+ * @return          1 if the top was replaced, otherwise 0 if the heap is empty
+ */
+int binary_heap_replace(binary_heap_t* heap, void* data, void** out)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_POINTERS);
+    assert(out);
+
+    skip_dead(heap);
+    if (heap->size == 0)
+        return 0;
+
+    /* Sized like any stored element, as element_move handles every kind */
+    union
+    {
+        void*        ptr;
+        heap_entry_t entry;
+    } slot;
+    slot.ptr = data;
+
+    *out = HEAP_PTR(heap, 0);
+    replace_root(heap, (const unsigned char*)&slot);
+    return 1;
+}
+
+/**
+ * Sized version of binary_heap_replace, the popped element is copied out
+ * before elem is copied in and sifted down.
+ * O(logn)
+ *
+ * @param[in]  heap The sized binary heap
+ * @param[in]  elem The element to add
+ * @param[out] out  Room for elem_size bytes to receive the removed element, or NULL
+ * @return          1 if the top was replaced, otherwise 0 if the heap is empty
+ */
+int binary_heap_replace_value(binary_heap_t* heap, const void* elem, void* out)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_VALUES);
+    assert(elem);
+
+    skip_dead(heap);
+    if (heap->size == 0)
+        return 0;
+
+    if (out)
+        memcpy(out, HEAP_SLOT(heap, 0), heap->elem_size);
+    replace_root(heap, (const unsigned char*)elem);
+    return 1;
+}
+
+/**
+ * Keyed version of binary_heap_pushpop.
+ * O(1) if payload is handed back, otherwise O(logn)
+ *
+ * @param[in]  heap     The keyed binary heap
+ * @param[in]  key      The priority of the element, smallest first
+ * @param[in]  payload  The data element to add
+ * @param[out] out      The out ptr to the removed payload, payload itself or the old top
+ * @return              1 if payload was added to the heap, otherwise 0
+ */
+int binary_heap_pushpop_key(binary_heap_t* heap, uint64_t key, void* payload, void** out)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_KEYS);
+    assert(out);
+
+    heap_entry_t entry;
+    entry.key.u = key;
+    entry.payload = payload;
+
+    *out = payload;
+    return (pushpop_slot(heap, (const unsigned char*)&entry, out));
+}
+
+/**
+ * Keyed version of binary_heap_replace, e.g. to reschedule a periodic
+ * timer popped off the top.
+ * O(logn)
+ *
+ * @param[in]  heap     The keyed binary heap
+ * @param[in]  key      The priority of the element, smallest first
+ * @param[in]  payload  The data element to add
+ * @param[out] out      The out ptr to the removed payload
+ * @return              1 if the top was replaced, otherwise 0 if the heap is empty
+ */
+int binary_heap_replace_key(binary_heap_t* heap, uint64_t key, void* payload, void** out)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_KEYS);
+    assert(out);
+
+    skip_dead(heap);
+    if (heap->size == 0)
+        return 0;
+
+    heap_entry_t entry;
+    entry.key.u = key;
+    entry.payload = payload;
+
+    *out = HEAP_ENTRY(heap, 0).payload;
+    replace_root(heap, (const unsigned char*)&entry);
+    return 1;
+}
+
+/**
+ * Sort a binary heap in place and hand its storage to the caller, leaving
+ * the heap empty and reusable. No memory is allocated, the heap's own
+ * array becomes the returned buffer, in the order the elements would have
+ * been popped. Pointer heaps return an array of void*, keyed heaps an
+ * array of payload void*, and sized heaps an array of elements. Free it
+ * with BINARY_HEAP_FREE. Heaps with their own allocator keep their storage,
+ * the caller could not free it without knowing its size, so they return
+ * NULL and are left as they were, see binary_heap_sort_in_place instead.
+ * Handle tracking is turned off.
+ * O(nlogn)
+ *
+ * @param[in]  heap  The binary heap
+ * @param[out] count The number of elements in the returned buffer
+ * @return           The sorted buffer, otherwise NULL if the heap is empty
+ *                   or has its own allocator
+ */
+void* binary_heap_drain_sorted(binary_heap_t* heap, size_t* count)
+{
+    assert(heap);
+    assert(count);
+
+    return (drain(heap, heap->size, count));
+}
+
+/**
+ * Like binary_heap_drain_sorted, but only the first k elements of the
+ * returned buffer are sorted, the rest follow in no particular order.
+ * O(n + klogn)
+ *
+ * @param[in]  heap  The binary heap
+ * @param[in]  k     The number of top-most elements to sort
+ * @param[out] count The number of elements in the returned buffer, all of them
+ * @return           The buffer, otherwise NULL if the heap is empty or has
+ *                   its own allocator
+ */
+void* binary_heap_drain_partial(binary_heap_t* heap, size_t k, size_t* count)
+{
+    assert(heap);
+    assert(count);
+
+    return (drain(heap, k < heap->size ? k : heap->size, count));
+}
+
+/**
+ * Sort a pointer or sized binary heap in place without giving its storage
+ * away. An array in pop order is itself a valid heap, so the heap keeps
+ * every element and can be used as before. Pointer heaps return their
+ * array of void*, sized heaps their array of elements, valid until the
+ * heap is next modified. Cancelled elements are dropped first. Not for
+ * heaps with handle tracking.
+ * O(nlogn)
+ *
+ * @param[in]  heap  The pointer or sized binary heap
+ * @param[out] count The number of elements in the returned array
+ * @return           The sorted elements, otherwise NULL if the heap is empty
+ */
+void* binary_heap_sort_in_place(binary_heap_t* heap, size_t* count)
+{
+    assert(heap);
+    assert(count);
+    assert(heap->kind == HEAP_POINTERS || heap->kind == HEAP_VALUES);
+    assert(!heap->handles);
+
+    if (heap->dead)
+        compact(heap);
+
+    *count = heap->size;
+    if (heap->size == 0)
+        return NULL;
+
+    sort_storage(heap, heap->size);
+    return (heap->data);
+}
+
+/**
+ * Remove every element from a binary heap, keeping its storage. Elements
+ * are not freed, and every tracked handle is released.
+ * O(1), O(b) for radix heaps
+ *
  * @param[in] heap  The binary heap
- * @param[in] index The current heap index
  */
-void bubble_down(binary_heap_t* heap, size_t index)
+void binary_heap_clear(binary_heap_t* heap)
 {
     assert(heap);
-    assert(index >= 0);
-    assert(index < heap->size);
 
-    /* We are at the bottom of the heap, we are sorted */
-    if (index == heap->size - 1)
-        return;
+    size_t b;
+    for (b = 0; heap->radix && b < HEAP_RADIX_BUCKETS; ++b)
+        heap->radix->counts[b] = 0;
+    if (heap->radix)
+        heap->radix->last = 0;
+
+    heap->size = 0;
+    heap->dead = 0;
+    heap->handle_count = 0;
+}
+
+/**
+ * Make room for count more elements up front, growing the storage to
+ * exactly that size, so a heap that is filled to a known size allocates
+ * once. Bounded heaps always have room for their bound.
+ * O(n) if the storage grows, otherwise O(1)
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] count The number of elements about to be added
+ * @return          1 if there is room, otherwise 0 and the heap is unchanged
+ */
+int binary_heap_reserve(binary_heap_t* heap, size_t count)
+{
+    assert(heap);
+    assert(!heap->radix);
+
+    if (count >= HEAP_CAPACITY_MAX - heap->size)
+        return 0;
+
+    size_t needed = heap->size + count;
+    if (needed <= heap->capacity)
+        return 1;
+
+    /* Bounded and non-resizing heaps grow as they always do */
+    if (heap->bound || (!BINARY_HEAP_RESIZE && heap->capacity))
+        return (reserve_grow(heap, needed));
+
+    return (storage_grow(heap, needed));
+}
+
+/**
+ * Offer a data element to a bounded binary heap. While the heap holds
+ * fewer than k elements it is pushed. After that it is rejected after a
+ * single comparison unless the root compares before it, in which case it
+ * replaces the root with a single sift down.
+ * O(1) if rejected, otherwise O(logk)
+ *
+ * @param[in]  heap     The bounded binary heap
+ * @param[in]  data     The data element to offer
+ * @param[out] evicted  The out ptr to the evicted root, set to NULL if nothing was evicted, may be NULL
+ * @return              1 if the element was kept, otherwise 0
+ */
+int binary_heap_offer(binary_heap_t* heap, void* data, void** evicted)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_POINTERS);
+
+    return (offer_slot(heap, (const unsigned char*)&data, evicted));
+}
+
+/**
+ * Offer a keyed data element to a bounded keyed binary heap, keeping it if
+ * its key is larger than the smallest kept key. See binary_heap_offer.
+ * O(1) if rejected, otherwise O(logk)
+ *
+ * @param[in]  heap     The bounded keyed binary heap
+ * @param[in]  key      The key of the element
+ * @param[in]  payload  The data element to offer
+ * @param[out] evicted  The out ptr to the evicted payload, set to NULL if nothing was evicted, may be NULL
+ * @return              1 if the element was kept, otherwise 0
+ */
+int binary_heap_offer_key(binary_heap_t* heap, uint64_t key, void* payload, void** evicted)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_KEYS);
+
+    heap_entry_t entry;
+    entry.key.u = key;
+    entry.payload = payload;
+
+    return (offer_slot(heap, (const unsigned char*)&entry, evicted));
+}
+
+/**
+ * Remove up to count top-most elements from a binary heap. The removed
+ * elements are written to out in the order they would have been popped.
+ * Keyed heaps write the payloads.
+ * O(k logn)
+ *
+ * @param[in]  heap  The binary heap
+ * @param[out] out   The array to receive the removed data elements
+ * @param[in]  count The maximum number of elements to remove
+ * @return           The number of elements removed
+ */
+size_t binary_heap_pop_n(binary_heap_t* heap, void** out, size_t count)
+{
+    assert(heap);
+    assert(heap->kind != HEAP_VALUES);
+    assert(out || count == 0);
+
+    if (count > heap->size)
+        count = heap->size;
+
+    size_t i;
+    for (i = 0; i < count; ++i) {
+        if (heap->radix) {
+            if (!radix_pop(heap, &out[i]))
+                break;
+            continue;
+        }
+
+        skip_dead(heap);
+        if (heap->size == 0)
+            break;
 
-    size_t swp   = index;
-    size_t left  = (index << 1) + 1;
-    size_t right = (index << 1) + 2;
+        out[i] = element(heap, 0);
+        pop_root(heap);
+    }
 
-    /* If this element compares less than its left child or right children swap it */
-    if (left < heap->size && heap->cmp(heap->data[left], heap->data[swp]) < 0)
-        swp = left;
-    if (right < heap->size && heap->cmp(heap->data[right], heap->data[swp]) < 0)
-        swp = right;
+    return i;
+}
 
-    /* Perform the actual swap, and continue to bubble down */
-    if (swp != index) {
-        void* tmp = heap->data[index];
-        heap->data[index] = heap->data[swp];
-        heap->data[swp] = tmp;
+/**
+ * Peek at the top-most data element in a binary heap. The caller
+ * should NOT modify it's data as it may invalidate the state of
+ * the heap. Sized heaps return a pointer to the stored element, which
+ * stays valid until the heap is next modified. Keyed heaps return the
+ * payload.
+ * O(1), amortized O(log C) for radix heaps
+ * 
+ * @param[in]  heap    The binary heap
+ * @param[out] out     The out ptr to the top-most element if exists, otherwise NULL
+ */
+void binary_heap_peek(binary_heap_t* heap, void** out)
+{
+    assert(heap);
 
-        bubble_down(heap, swp);
+    if (heap->radix) {
+        *out = (radix_settle(heap) ? heap->radix->buckets[0][heap->radix->counts[0] - 1].payload : NULL);
+        return;
     }
+
+    skip_dead(heap);
+    *out = (heap->size > 0 ? element(heap, 0) : NULL);
+}
+
+/**
+ * Peek at the smallest key in a keyed binary heap.
+ * O(1), amortized O(log C) for radix heaps
+ *
+ * @param[in]  heap The keyed binary heap
+ * @param[out] out  The out ptr to the top-most key, untouched if the heap is empty
+ * @return          1 if the heap has a top-most element, otherwise 0
+ */
+int binary_heap_peek_key(binary_heap_t* heap, uint64_t* out)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_KEYS || heap->kind == HEAP_RADIX);
+
+    if (heap->radix) {
+        if (!radix_settle(heap))
+            return 0;
+
+        *out = heap->radix->last;
+        return 1;
+    }
+
+    skip_dead(heap);
+    if (heap->size == 0)
+        return 0;
+
+    *out = HEAP_ENTRY(heap, 0).key.u;
+    return 1;
+}
+
+/**
+ * Peek at the smallest key in a double keyed binary heap.
+ * O(1)
+ *
+ * @param[in]  heap The double keyed binary heap
+ * @param[out] out  The out ptr to the top-most key, untouched if the heap is empty
+ * @return          1 if the heap has a top-most element, otherwise 0
+ */
+int binary_heap_peek_key_double(binary_heap_t* heap, double* out)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_KEYS_DOUBLE);
+
+    skip_dead(heap);
+    if (heap->size == 0)
+        return 0;
+
+    *out = HEAP_ENTRY(heap, 0).key.d;
+    return 1;
+}
+
+/**
+ * Restore the heap ordering of every data element in a binary heap by
+ * bubbling down each internal node, starting from the last parent. Useful
+ * after bulk loading, or after the priorities of stored elements changed.
+ * O(n)
+ *
+ * @param[in] heap  The binary heap
+ */
+void binary_heap_heapify(binary_heap_t* heap)
+{
+    assert(heap);
+    assert(!heap->radix);
+
+    if (heap->size < 2)
+        return;
+
+    size_t i = HEAP_PARENT(heap->size - 1) + 1;
+    while (i-- > 0)
+        bubble_down(heap, i);
+}
+
+/**
+ * Heapify like binary_heap_heapify, spread over threads. The subtrees
+ * under one level of the heap are heapified concurrently, each thread
+ * taking a contiguous run of them, then the levels above are finished on
+ * the calling thread. Every node is still sifted after its descendants
+ * and the same way, so the result and the comparison count are exactly
+ * those of binary_heap_heapify. Small heaps, single threads and builds
+ * without BINARY_HEAP_THREADS heapify serially.
+ * O(n / threads + threads log n)
+ *
+ * @param[in] heap    The binary heap
+ * @param[in] threads The number of threads including the caller, 0 for one per online CPU
+ */
+void binary_heap_heapify_parallel(binary_heap_t* heap, size_t threads)
+{
+    assert(heap);
+    assert(!heap->radix);
+
+#if BINARY_HEAP_THREADS
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0 ? (size_t)cpus : 1);
+    }
+    if (threads > heap->size / HEAP_PARALLEL_MIN)
+        threads = heap->size / HEAP_PARALLEL_MIN;
+#else
+    threads = 1;
+#endif
+
+    heap_worker_t* workers = NULL;
+    if (threads > 1)
+        workers = (heap_worker_t*)heap_alloc(heap, threads * sizeof(heap_worker_t));
+    if (!workers) {
+        binary_heap_heapify(heap);
+        return;
+    }
+
+    /* The first level with a few subtrees per thread, to even out the
+     * partial bottom level */
+    size_t first = 0, width = 1;
+    while (width < threads * 4) {
+        first = first * BINARY_HEAP_ARITY + 1;
+        width *= BINARY_HEAP_ARITY;
+    }
+    if (width > heap->size - first)
+        width = heap->size - first;
+
+    size_t t;
+    for (t = 0; t < threads; ++t) {
+        heap_worker_t* worker = &workers[t];
+        worker->view = *heap;
+        worker->view.comparisons = 0;
+        worker->view.scratch = (heap->kind == HEAP_VALUES ? heap_alloc(heap, heap->elem_size) : (void*)&worker->view.held);
+#if BINARY_HEAP_STATS
+        memset(&worker->view.stats, 0, sizeof(binary_heap_stats_t));
+#endif
+        worker->first = first + width * t / threads;
+        worker->last = first + width * (t + 1) / threads;
+    }
+
+    /* Worker 0 runs on the caller, as does any worker that fails to start */
+#if BINARY_HEAP_THREADS
+    for (t = 1; t < threads; ++t) {
+        workers[t].started = (workers[t].view.scratch &&
+                              pthread_create(&workers[t].thread, NULL, &heapify_worker, &workers[t]) == 0);
+    }
+#endif
+
+    for (t = 0; t < threads; ++t) {
+        heap_worker_t* worker = &workers[t];
+#if BINARY_HEAP_THREADS
+        if (t > 0 && worker->started)
+            pthread_join(worker->thread, NULL);
+        else
+#endif
+            heapify_range(worker->view.scratch ? &worker->view : heap, worker->first, worker->last);
+
+        heap->comparisons += worker->view.comparisons;
+#if BINARY_HEAP_STATS
+        heap->stats.moves += worker->view.stats.moves;
+        size_t b;
+        for (b = 0; b < BINARY_HEAP_STATS_BUCKETS; ++b)
+            heap->stats.sift_depth[b] += worker->view.stats.sift_depth[b];
+#endif
+        if (worker->view.scratch != (void*)&worker->view.held)
+            heap_free(heap, worker->view.scratch, heap->elem_size);
+    }
+
+    heap_free(heap, workers, threads * sizeof(heap_worker_t));
+
+    while (first-- > 0)
+        bubble_down(heap, first);
+}
+
+/**
+ * Choose how pops restore heap order. Top-down sifts compare the moved
+ * element against the best child at every level. Bottom-up sifts walk the
+ * hole to a leaf along the best child path without comparing the moved
+ * element, then sift it up from there. The element popped into the root
+ * usually belongs near the bottom, so bottom-up pops need about half the
+ * comparisons, which pays off when comparitors are expensive.
+ *
+ * @param[in] heap    The binary heap
+ * @param[in] enabled 1 for bottom-up pops, 0 for top-down pops
+ */
+void binary_heap_set_bottom_up(binary_heap_t* heap, int enabled)
+{
+    assert(heap);
+    heap->bottom_up = (enabled != 0);
+}
+
+/**
+ * Choose how keyed heaps with integer keys pick the best child. With SIMD
+ * all BINARY_HEAP_ARITY keys of a full set of children are compared at
+ * once in AVX2 or SSE4.2 registers instead of one at a time. Picks the
+ * same child either way and counts the same comparisons. On by default
+ * where available, needs a BINARY_HEAP_ARITY of 4, 8 or 16 and an x86-64 CPU.
+ *
+ * @param[in] heap    The binary heap
+ * @param[in] enabled 1 to use SIMD if available, 0 for scalar compares
+ * @return            1 if SIMD child selection is now in use, otherwise 0
+ */
+int binary_heap_set_simd(binary_heap_t* heap, int enabled)
+{
+    assert(heap);
+    heap->simd = (enabled && heap->kind == HEAP_KEYS ? simd_level() : HEAP_SIMD_NONE);
+    return (heap->simd != HEAP_SIMD_NONE);
+}
+
+/**
+ * Turn on lazy deletion. Cancel an element by marking it in a way is_dead
+ * can see, e.g. a cancelled flag in the element, then calling
+ * binary_heap_cancel. Cancelled elements stay in the heap until they reach
+ * the top, where pops and peeks skip them, or until they make up more than
+ * compact_at of the heap, which then drops all of them and re-heapifies,
+ * shrinking storage to fit. Needs no handle tracking, and cannot be used
+ * with it.
+ *
+ * is_dead sees what pops return: elements, payloads for keyed heaps, or
+ * pointers to the stored element for sized heaps.
+ *
+ * @param[in] heap          The binary heap
+ * @param[in] is_dead       The predicate for cancelled elements
+ * @param[in] compact_at    The fraction of cancelled elements that triggers a compaction, (0, 1]
+ */
+void binary_heap_set_tombstones(binary_heap_t* heap, dead_f is_dead, double compact_at)
+{
+    assert(heap);
+    assert(is_dead);
+    assert(compact_at > 0.0 && compact_at <= 1.0);
+    assert(!heap->handles && !heap->radix);
+
+    heap->is_dead = is_dead;
+    heap->compact_at = compact_at;
+}
+
+/**
+ * Count an element as cancelled, after marking it so is_dead sees it as
+ * dead. Compacts the heap once cancelled elements pass the compact_at
+ * fraction. Each element must be cancelled at most once.
+ * O(1), O(n) when compacting
+ *
+ * @param[in] heap  The binary heap, with lazy deletion on
+ * @param[in] data  The cancelled element, for checking
+ */
+void binary_heap_cancel(binary_heap_t* heap, void* data)
+{
+    assert(heap);
+    assert(heap->is_dead);
+    assert(heap->is_dead(data));
+    assert(heap->dead < heap->size);
+    (void)data;
+
+    if (++heap->dead > heap->compact_at * heap->size)
+        compact(heap);
+}
+
+/**
+ * Get the number of element comparisons a binary heap has made since it
+ * was created. Counts comparitor calls, or key comparisons for keyed heaps,
+ * when built with BINARY_HEAP_COUNT_COMPARISONS or BINARY_HEAP_STATS.
+ * Otherwise nothing is counted and this is always 0. Iterators never count.
+ * O(1)
+ *
+ * @param[in] heap  The binary heap
+ * @return          The number of comparisons
+ */
+size_t binary_heap_comparisons(binary_heap_t* heap)
+{
+    assert(heap);
+    return (heap->comparisons);
+}
+
+/**
+ * Get the operation stats of a binary heap since it was created: element
+ * comparisons and moves, storage resizes and the bytes they reallocated,
+ * the largest size reached and a log-scale histogram of how many levels
+ * each sift moved an element. Unless built with BINARY_HEAP_STATS only
+ * comparisons are filled in, as binary_heap_comparisons, the rest is 0.
+ * O(1)
+ *
+ * @param[in]  heap The binary heap
+ * @param[out] out  The stats
+ * @return          1 if built with BINARY_HEAP_STATS, otherwise 0
+ */
+int binary_heap_stats(binary_heap_t* heap, binary_heap_stats_t* out)
+{
+    assert(heap);
+    assert(out);
+
+#if BINARY_HEAP_STATS
+    *out = heap->stats;
+#else
+    memset(out, 0, sizeof(*out));
+#endif
+    out->comparisons = heap->comparisons;
+
+    return (BINARY_HEAP_STATS);
+}
+
+/**
+ * Enable handle tracking on an empty pointer or keyed binary heap. Tracked
+ * heaps give every element a handle that stays valid until the element is
+ * popped or removed, and keep each element's position up to date as it
+ * moves, so binary_heap_update and binary_heap_remove can find it. Handles
+ * of popped or removed elements are reused.
+ * O(1)
+ *
+ * @param[in] heap  The binary heap
+ * @return          1 if tracking is enabled, otherwise 0
+ */
+int binary_heap_track_handles(binary_heap_t* heap)
+{
+    assert(heap);
+    assert(heap->size == 0);
+    assert(heap->kind != HEAP_VALUES && heap->kind != HEAP_RADIX);
+    assert(!heap->is_dead);
+
+    if (heap->handles)
+        return 1;
+
+    heap->positions = (size_t*)heap_alloc(heap, heap->capacity * sizeof(size_t));
+    heap->handles = (binary_heap_handle_t*)heap_alloc(heap, heap->capacity * sizeof(binary_heap_handle_t));
+
+    assert(heap->positions && heap->handles);
+    if (!heap->positions || !heap->handles) {
+        heap_free(heap, heap->positions, heap->capacity * sizeof(size_t));
+        heap_free(heap, heap->handles, heap->capacity * sizeof(binary_heap_handle_t));
+        heap->positions = NULL;
+        heap->handles = NULL;
+        return 0;
+    }
+
+    heap->handle_count = 0;
+    return 1;
+}
+
+/**
+ * Add a new data element to a tracked pointer heap.
+ * O(logn)
+ *
+ * @param[in] heap  The binary heap, with handle tracking enabled
+ * @param[in] data  The data element to add
+ * @return          The element handle if the add is successful, otherwise BINARY_HEAP_NO_HANDLE
+ */
+binary_heap_handle_t binary_heap_push_handle(binary_heap_t* heap, void* data)
+{
+    assert(heap);
+    assert(heap->handles);
+
+    binary_heap_handle_t handle = next_handle(heap);
+    return (binary_heap_push(heap, data) ? handle : BINARY_HEAP_NO_HANDLE);
+}
+
+/**
+ * Add a new data element to a tracked keyed heap.
+ * O(logn)
+ *
+ * @param[in] heap     The keyed binary heap, with handle tracking enabled
+ * @param[in] key      The priority of the element, smallest first
+ * @param[in] payload  The data element to add
+ * @return             The element handle if the add is successful, otherwise BINARY_HEAP_NO_HANDLE
+ */
+binary_heap_handle_t binary_heap_push_key_handle(binary_heap_t* heap, uint64_t key, void* payload)
+{
+    assert(heap);
+    assert(heap->handles);
+
+    binary_heap_handle_t handle = next_handle(heap);
+    return (binary_heap_push_key(heap, key, payload) ? handle : BINARY_HEAP_NO_HANDLE);
+}
+
+/**
+ * Add a new data element to a tracked double keyed heap.
+ * O(logn)
+ *
+ * @param[in] heap     The double keyed binary heap, with handle tracking enabled
+ * @param[in] key      The priority of the element, smallest first
+ * @param[in] payload  The data element to add
+ * @return             The element handle if the add is successful, otherwise BINARY_HEAP_NO_HANDLE
+ */
+binary_heap_handle_t binary_heap_push_key_double_handle(binary_heap_t* heap, double key, void* payload)
+{
+    assert(heap);
+    assert(heap->handles);
+
+    binary_heap_handle_t handle = next_handle(heap);
+    return (binary_heap_push_key_double(heap, key, payload) ? handle : BINARY_HEAP_NO_HANDLE);
+}
+
+/**
+ * Check whether a handle refers to an element still in a tracked heap.
+ * O(1)
+ *
+ * @param[in] heap   The binary heap, with handle tracking enabled
+ * @param[in] handle The element handle
+ * @return           1 if the element is in the heap, otherwise 0
+ */
+int binary_heap_contains(binary_heap_t* heap, binary_heap_handle_t handle)
+{
+    assert(heap);
+    assert(heap->handles);
+
+    return (handle < heap->handle_count && heap->positions[handle] != BINARY_HEAP_NO_HANDLE);
+}
+
+/**
+ * Restore heap order after the priority of a tracked element changed in
+ * either direction, e.g. a decrease-key or increase-key done by modifying
+ * the pointed-to data.
+ * O(logn)
+ *
+ * @param[in] heap   The binary heap, with handle tracking enabled
+ * @param[in] handle The handle of the changed element
+ */
+void binary_heap_update(binary_heap_t* heap, binary_heap_handle_t handle)
+{
+    assert(heap);
+    assert(binary_heap_contains(heap, handle));
+
+    resift(heap, heap->positions[handle]);
+}
+
+/**
+ * Change the key of a tracked keyed heap element.
+ * O(logn)
+ *
+ * @param[in] heap   The keyed binary heap, with handle tracking enabled
+ * @param[in] handle The handle of the element
+ * @param[in] key    The new key
+ */
+void binary_heap_update_key(binary_heap_t* heap, binary_heap_handle_t handle, uint64_t key)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_KEYS);
+    assert(binary_heap_contains(heap, handle));
+
+    size_t index = heap->positions[handle];
+    HEAP_ENTRY(heap, index).key.u = key;
+    resift(heap, index);
+}
+
+/**
+ * Change the key of a tracked double keyed heap element.
+ * O(logn)
+ *
+ * @param[in] heap   The double keyed binary heap, with handle tracking enabled
+ * @param[in] handle The handle of the element
+ * @param[in] key    The new key
+ */
+void binary_heap_update_key_double(binary_heap_t* heap, binary_heap_handle_t handle, double key)
+{
+    assert(heap);
+    assert(heap->kind == HEAP_KEYS_DOUBLE);
+    assert(binary_heap_contains(heap, handle));
+    assert(key == key);
+
+    size_t index = heap->positions[handle];
+    HEAP_ENTRY(heap, index).key.d = key;
+    resift(heap, index);
+}
+
+/**
+ * Remove a tracked element from anywhere in a binary heap.
+ * O(logn)
+ *
+ * @param[in]  heap   The binary heap, with handle tracking enabled
+ * @param[in]  handle The handle of the element to remove
+ * @param[out] out    The out ptr to the removed data element, may be NULL
+ */
+void binary_heap_remove(binary_heap_t* heap, binary_heap_handle_t handle, void** out)
+{
+    assert(heap);
+    assert(binary_heap_contains(heap, handle));
+
+    size_t index = heap->positions[handle];
+    if (out)
+        *out = element(heap, index);
+
+    remove_at(heap, index);
+}
+
+
+/* Internal Helpers */
+
+/**
+ * Make sure the binary heap has room for count more data elements, growing
+ * it with a single realloc if needed. Capacity keeps doubling so the heap
+ * grows the same way it does for single pushes. On failure the heap is left
+ * untouched.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] count The number of elements about to be added
+ * @return          1 if there is enough room, otherwise 0
+ */
+int reserve(binary_heap_t* heap, size_t count)
+{
+    /* Check for overflow */
+    if (count >= HEAP_CAPACITY_MAX - heap->size)
+        return 0;
+
+    size_t needed = heap->size + count;
+    if (needed > heap->capacity && !reserve_grow(heap, needed))
+        return 0;
+
+    HEAP_STAT_MAX(heap, max_size, needed);
+    return 1;
+}
+
+/**
+ * Grow the storage of a binary heap to hold needed elements, for reserve.
+ *
+ * @param[in] heap   The binary heap
+ * @param[in] needed The number of elements to hold, more than the capacity
+ * @return           1 if the heap grew, otherwise 0 and the heap is unchanged
+ */
+int reserve_grow(binary_heap_t* heap, size_t needed)
+{
+    /* Bounded heaps only ever have room for exactly their bound */
+    if (heap->bound)
+        return (needed <= heap->bound && storage_grow(heap, heap->bound));
+
+    if (!BINARY_HEAP_RESIZE && heap->capacity)
+        return 0;
+
+    /* Drained heaps start over */
+    size_t new_capacity = (heap->capacity ? heap->capacity : BINARY_HEAP_INITIAL_CAPACITY);
+    while (new_capacity < needed) {
+        /* Stop doubling before we overflow */
+        if (new_capacity > HEAP_CAPACITY_MAX / 2 / heap->elem_size) {
+            new_capacity = needed;
+            break;
+        }
+        new_capacity <<= 1;
+    }
+
+    return storage_grow(heap, new_capacity);
+}
+
+/**
+ * Restore heap order after elements were appended from index first on,
+ * by bubbling each one up or re-heapifying, whichever is cheaper.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] first The heap index of the first appended element
+ */
+void order_appended(binary_heap_t* heap, size_t first)
+{
+    size_t i;
+    if (prefer_heapify(first, heap->size - first)) {
+        binary_heap_heapify(heap);
+    }
+    else {
+        for (i = first; i < heap->size; ++i)
+            bubble_up(heap, i);
+    }
+}
+
+/**
+ * Decide whether count new elements appended to a heap of size elements are
+ * cheaper to order by re-heapifying everything, roughly 2(n + k) comparisons,
+ * or by bubbling each one up, at most k log(n + k) comparisons.
+ *
+ * @param[in] size  The number of elements already in heap order
+ * @param[in] count The number of appended elements
+ * @return          1 if a full heapify is cheaper, otherwise 0
+ */
+int prefer_heapify(size_t size, size_t count)
+{
+    size_t total = size + count;
+    size_t depth = 0;
+
+    while (total >>= 1)
+        ++depth;
+
+    return (count * depth > 2 * (size + count));
+}
+
+/**
+ * Bubbles up the data element at index based on the user comparitor
+ * function (min/max). Parents are shifted down into a hole instead of
+ * swapped, so the element itself is moved only once.
+ * 
+ * @param[in] heap  The binary heap
+ * @param[in] index The current heap index
+ */
+void bubble_up(binary_heap_t* heap, size_t index)
+{
+    assert(heap);
+    assert(index < heap->size);
+
+    /* Leave the element in place if it is already sorted, a sift of 0 levels */
+    if (index == 0 || !element_less(heap, HEAP_SLOT(heap, index), HEAP_SLOT(heap, HEAP_PARENT(index)))) {
+        HEAP_STAT_SIFT_START(heap, index);
+        HEAP_STAT_SIFT_END(heap, index);
+        return;
+    }
+
+    unsigned char* held = (unsigned char*)heap->scratch;
+    hold_element(heap, index);
+
+    do {
+        size_t parent = HEAP_PARENT(index);
+        shift_element(heap, index, parent);
+        index = parent;
+    } while (index > 0 && element_less(heap, held, HEAP_SLOT(heap, HEAP_PARENT(index))));
+
+    place_held(heap, index);
+}
+
+/**
+ * Bubbles down the data element at index based on the user comparitor
+ * function (min/max). The best child is shifted up into a hole at each
+ * level until the element is no worse than any child, then the element
+ * is moved into the hole once.
+ * 
+ * @param[in] heap  The binary heap
+ * @param[in] index The current heap index
+ */
+void bubble_down(binary_heap_t* heap, size_t index)
+{
+    assert(heap);
+    assert(index < heap->size);
+
+    hold_element(heap, index);
+    sink_held(heap, index);
+}
+
+/**
+ * Sift the held scratch element down from the hole at index and place it.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] index The heap index of the hole
+ */
+void sink_held(binary_heap_t* heap, size_t index)
+{
+    unsigned char* held = (unsigned char*)heap->scratch;
+
+    for (;;) {
+        size_t child = best_child(heap, index);
+        if (child == 0 || !element_less(heap, HEAP_SLOT(heap, child), held))
+            break;
+
+        shift_element(heap, index, child);
+        index = child;
+    }
+
+    place_held(heap, index);
+}
+
+/**
+ * Bottom-up (Floyd/Wegener) variant of bubble_down. The hole walks all
+ * the way to a leaf along the best child path without comparing against
+ * the element, then the element is bubbled up from that leaf, never
+ * above its starting index.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] index The current heap index
+ */
+void bubble_down_bottom_up(binary_heap_t* heap, size_t index)
+{
+    assert(heap);
+    assert(index < heap->size);
+
+    hold_element(heap, index);
+    sink_held_bottom_up(heap, index);
+}
+
+/**
+ * Bottom-up version of sink_held.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] index The heap index of the hole
+ */
+void sink_held_bottom_up(binary_heap_t* heap, size_t index)
+{
+    unsigned char* held = (unsigned char*)heap->scratch;
+
+    size_t top = index;
+    size_t child;
+    while ((child = best_child(heap, index)) != 0) {
+        shift_element(heap, index, child);
+        index = child;
+    }
+
+    while (index > top && element_less(heap, held, HEAP_SLOT(heap, HEAP_PARENT(index)))) {
+        size_t parent = HEAP_PARENT(index);
+        shift_element(heap, index, parent);
+        index = parent;
+    }
+
+    place_held(heap, index);
+}
+
+/**
+ * Find the best child of the element at index.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] index The parent heap index
+ * @return          The heap index of the best child, or 0 if index is a leaf
+ */
+size_t best_child(binary_heap_t* heap, size_t index)
+{
+    size_t child = HEAP_FIRST_CHILD(index);
+    if (child >= heap->size)
+        return 0;
+
+    size_t last = child + BINARY_HEAP_ARITY;
+#if HEAP_SIMD
+    if (heap->simd && last <= heap->size) {
+        HEAP_COUNT_COMPARISONS(heap, BINARY_HEAP_ARITY - 1);
+        if (heap->simd == HEAP_SIMD_AVX2)
+            return child + best_key_avx2(&HEAP_ENTRY(heap, child));
+        return child + best_key_sse42(&HEAP_ENTRY(heap, child));
+    }
+#endif
+    if (last > heap->size)
+        last = heap->size;
+
+    size_t best = child;
+    for (++child; child < last; ++child) {
+        if (element_less(heap, HEAP_SLOT(heap, child), HEAP_SLOT(heap, best)))
+            best = child;
+    }
+
+    return best;
+}
+
+/**
+ * Find the best SIMD child selection level the CPU supports, checked once.
+ *
+ * @return  HEAP_SIMD_AVX2, HEAP_SIMD_SSE42 or HEAP_SIMD_NONE
+ */
+int simd_level(void)
+{
+#if HEAP_SIMD
+    static int level = -1;
+    if (level < 0) {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            level = HEAP_SIMD_AVX2;
+        else if (__builtin_cpu_supports("sse4.2"))
+            level = HEAP_SIMD_SSE42;
+        else
+            level = HEAP_SIMD_NONE;
+    }
+    return level;
+#else
+    return HEAP_SIMD_NONE;
+#endif
+}
+
+#if HEAP_SIMD
+/* Keys are unsigned, flipping the sign bit lets signed compares order them */
+#define HEAP_SIGN_BIT ((long long)0x8000000000000000ULL)
+
+/**
+ * Find the smallest integer key among BINARY_HEAP_ARITY entries with AVX2.
+ * Ties go to the first, like the scalar loop in best_child.
+ *
+ * @param[in] children  The first of BINARY_HEAP_ARITY heap_entry_t children
+ * @return              Offset of the best child from the first
+ */
+__attribute__((target("avx2")))
+size_t best_key_avx2(const void* children)
+{
+    const __m256i* entries = (const __m256i*)children;
+    const __m256i sign = _mm256_set1_epi64x(HEAP_SIGN_BIT);
+    __m256i keys[BINARY_HEAP_ARITY / 4];
+    __m256i best;
+    unsigned mask = 0;
+    size_t g;
+
+    /* Each pair of loads holds 4 entries, unpacking takes keys 0 2 1 3 */
+    for (g = 0; g < BINARY_HEAP_ARITY / 4; ++g) {
+        __m256i lo = _mm256_loadu_si256(entries + 2 * g);
+        __m256i hi = _mm256_loadu_si256(entries + 2 * g + 1);
+        keys[g] = _mm256_xor_si256(_mm256_unpacklo_epi64(lo, hi), sign);
+        best = (g ? _mm256_blendv_epi8(best, keys[g], _mm256_cmpgt_epi64(best, keys[g])) : keys[g]);
+    }
+
+    /* Spread the smallest key to every lane */
+    __m256i other = _mm256_permute4x64_epi64(best, 0x4E);
+    best = _mm256_blendv_epi8(best, other, _mm256_cmpgt_epi64(best, other));
+    other = _mm256_shuffle_epi32(best, 0x4E);
+    best = _mm256_blendv_epi8(best, other, _mm256_cmpgt_epi64(best, other));
+
+    /* Lanes 1 and 2 hold children 2 and 1, swap their bits back */
+    for (g = 0; g < BINARY_HEAP_ARITY / 4; ++g) {
+        unsigned m = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(keys[g], best)));
+        mask |= ((m & 9) | ((m & 2) << 1) | ((m & 4) >> 1)) << (4 * g);
+    }
+
+    return (size_t)__builtin_ctz(mask);
+}
+
+/**
+ * Find the smallest integer key among BINARY_HEAP_ARITY entries with
+ * SSE4.2, two keys per register.
+ *
+ * @param[in] children  The first of BINARY_HEAP_ARITY heap_entry_t children
+ * @return              Offset of the best child from the first
+ */
+__attribute__((target("sse4.2")))
+size_t best_key_sse42(const void* children)
+{
+    const __m128i* entries = (const __m128i*)children;
+    const __m128i sign = _mm_set1_epi64x(HEAP_SIGN_BIT);
+    __m128i keys[BINARY_HEAP_ARITY / 2];
+    __m128i best;
+    unsigned mask = 0;
+    size_t g;
+
+    for (g = 0; g < BINARY_HEAP_ARITY / 2; ++g) {
+        keys[g] = _mm_xor_si128(_mm_unpacklo_epi64(_mm_loadu_si128(entries + 2 * g),
+                                                   _mm_loadu_si128(entries + 2 * g + 1)), sign);
+        best = (g ? _mm_blendv_epi8(best, keys[g], _mm_cmpgt_epi64(best, keys[g])) : keys[g]);
+    }
+
+    __m128i other = _mm_shuffle_epi32(best, 0x4E);
+    best = _mm_blendv_epi8(best, other, _mm_cmpgt_epi64(best, other));
+
+    for (g = 0; g < BINARY_HEAP_ARITY / 2; ++g)
+        mask |= (unsigned)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(keys[g], best))) << (2 * g);
+
+    return (size_t)__builtin_ctz(mask);
+}
+#endif
+
+/**
+ * Remove the root of a non-empty heap, whose element the caller already
+ * took, by moving the last element into the root and bubbling it down.
+ *
+ * @param[in] heap  The binary heap
+ */
+void pop_root(binary_heap_t* heap)
+{
+    remove_at(heap, 0);
+}
+
+/**
+ * Heapsort the first k elements of a heap's array into pop order, the
+ * rest follow in no particular order. Handles are not kept up to date.
+ *
+ * @param[in] heap  The binary heap, without cancelled elements
+ * @param[in] k     The number of elements to sort
+ */
+void sort_storage(binary_heap_t* heap, size_t k)
+{
+    size_t n = heap->size;
+    unsigned char* held = (unsigned char*)heap->scratch;
+    size_t i;
+    for (i = 0; i < k && heap->size > 1; ++i) {
+        size_t last = --heap->size;
+        element_move(heap, held, HEAP_SLOT(heap, last));
+        element_move(heap, HEAP_SLOT(heap, last), HEAP_SLOT(heap, 0));
+        HEAP_STAT_SIFT_START(heap, 0);
+
+        if (heap->bottom_up)
+            sink_held_bottom_up(heap, 0);
+        else
+            sink_held(heap, 0);
+    }
+
+    for (i = 0; i < n / 2; ++i) {
+        element_move(heap, held, HEAP_SLOT(heap, i));
+        element_move(heap, HEAP_SLOT(heap, i), HEAP_SLOT(heap, n - 1 - i));
+        element_move(heap, HEAP_SLOT(heap, n - 1 - i), held);
+    }
+
+    heap->size = n;
+}
+
+/**
+ * Heapsort the top k elements of a heap in place, hand the storage over
+ * and reset the heap to empty with no storage. Each step moves the last
+ * element into the held scratch, the root into the freed last slot and
+ * sinks the held element from the root, so the top k end up at the back
+ * in reverse order. Reversing the whole array brings them to the front.
+ *
+ * @param[in]  heap  The binary heap
+ * @param[in]  k     The number of top-most elements to sort, at most heap size
+ * @param[out] count The number of elements in the returned buffer
+ * @return           The buffer, otherwise NULL if the heap is empty or has
+ *                   its own allocator
+ */
+void* drain(binary_heap_t* heap, size_t k, size_t* count)
+{
+    assert(!heap->radix);
+
+    /* Only BINARY_HEAP_FREE can free the buffer */
+    if (heap->allocator != &HEAP_DEFAULT_ALLOCATOR) {
+        *count = 0;
+        return NULL;
+    }
+
+    if (heap->dead)
+        compact(heap);
+
+    *count = heap->size;
+    if (heap->size == 0)
+        return NULL;
+
+    /* The buffer must come from the allocator, not the heap file */
+    if (heap->mapped && !unmap_storage(heap, heap->size)) {
+        *count = 0;
+        return NULL;
+    }
+
+    /* Drained elements have no handles */
+    if (heap->handles) {
+        heap_free(heap, heap->positions, heap->capacity * sizeof(size_t));
+        heap_free(heap, heap->handles, heap->capacity * sizeof(binary_heap_handle_t));
+        heap->positions = NULL;
+        heap->handles = NULL;
+        heap->handle_count = 0;
+    }
+
+    size_t n = heap->size;
+    size_t i;
+    sort_storage(heap, k);
+
+    /* Compact keyed entries to payloads, each write lands at or before
+     * the entry being read */
+    size_t out_size = heap->elem_size;
+    if (heap->kind == HEAP_KEYS || heap->kind == HEAP_KEYS_DOUBLE) {
+        for (i = 0; i < n; ++i)
+            ((void**)heap->data)[i] = HEAP_ENTRY(heap, i).payload;
+        out_size = sizeof(void*);
+    }
+
+    void* buffer = heap->block;
+    memmove(buffer, heap->data, n * out_size);
+
+    heap->block = NULL;
+    heap->block_size = 0;
+    heap->data = NULL;
+    heap->size = 0;
+    heap->capacity = 0;
+
+    return (buffer);
+}
+
+/**
+ * Overwrite the root of a non-empty heap with a new element and sift it
+ * down, a pop and push in a single sift. With handle tracking the new
+ * element takes over the root's handle.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] src   The new element
+ */
+void replace_root(binary_heap_t* heap, const unsigned char* src)
+{
+    element_move(heap, HEAP_SLOT(heap, 0), src);
+
+    if (heap->bottom_up)
+        bubble_down_bottom_up(heap, 0);
+    else
+        bubble_down(heap, 0);
+}
+
+/**
+ * Pop the root into out and put a new element in its place, unless the
+ * heap is empty or the new element compares before or equal to the root.
+ *
+ * @param[in]  heap The binary heap
+ * @param[in]  src  The new element
+ * @param[out] out  The out ptr to the popped element, left alone if src is not added
+ * @return          1 if src was added, otherwise 0
+ */
+int pushpop_slot(binary_heap_t* heap, const unsigned char* src, void** out)
+{
+    skip_dead(heap);
+    if (heap->size == 0 || !element_less(heap, HEAP_SLOT(heap, 0), src))
+        return 0;
+
+    *out = element(heap, 0);
+    replace_root(heap, src);
+    return 1;
+}
+
+/**
+ * Offer a new element to a bounded heap. Fills the heap up to its bound,
+ * then keeps the element only if the root compares before it, replacing
+ * the root.
+ *
+ * @param[in]  heap     The bounded binary heap
+ * @param[in]  src      The new element
+ * @param[out] evicted  The out ptr to the evicted root, set to NULL if nothing was evicted, may be NULL
+ * @return              1 if the element was kept, otherwise 0
+ */
+int offer_slot(binary_heap_t* heap, const unsigned char* src, void** evicted)
+{
+    assert(heap->bound);
+    assert(!heap->handles);
+
+    skip_dead(heap);
+    if (evicted)
+        *evicted = NULL;
+
+    /* Drained heaps have no storage until they are filled again */
+    if (heap->size < heap->bound) {
+        if (!reserve(heap, 1))
+            return 0;
+
+        element_move(heap, HEAP_SLOT(heap, heap->size), src);
+        ++heap->size;
+        bubble_up(heap, heap->size - 1);
+        return 1;
+    }
+
+    /* A single comparison rejects elements that would be the new root */
+    if (!element_less(heap, HEAP_SLOT(heap, 0), src))
+        return 0;
+
+    if (evicted)
+        *evicted = element(heap, 0);
+
+    replace_root(heap, src);
+    return 1;
+}
+
+/**
+ * Remove the element at index from a heap, whose element the caller
+ * already took, by moving the last element into its place and bubbling
+ * that up or down. A tracked handle of the removed element is freed.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] index The heap index of the element to remove
+ */
+void remove_at(binary_heap_t* heap, size_t index)
+{
+    binary_heap_handle_t freed = (heap->handles ? heap->handles[index] : 0);
+
+    if (--heap->size != index) {
+        shift_element(heap, index, heap->size);
+
+        if (index == 0 && heap->bottom_up)
+            bubble_down_bottom_up(heap, 0);
+        else
+            resift(heap, index);
+    }
+
+    /* Push the freed handle on the stack of free handles */
+    if (heap->handles) {
+        heap->handles[heap->size] = freed;
+        heap->positions[freed] = BINARY_HEAP_NO_HANDLE;
+    }
+}
+
+/**
+ * Restore heap order around the element at index, whose priority may have
+ * moved in either direction, by bubbling it up or down.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] index The heap index of the element
+ */
+void resift(binary_heap_t* heap, size_t index)
+{
+    if (index > 0 && element_less(heap, HEAP_SLOT(heap, index), HEAP_SLOT(heap, HEAP_PARENT(index))))
+        bubble_up(heap, index);
+    else
+        bubble_down(heap, index);
+}
+
+/**
+ * Check whether a stored element comes before another. Pointer heaps pass
+ * the stored pointers to the user comparitor function, sized heaps pass
+ * pointers to the stored elements, and keyed heaps compare their keys
+ * without any function call. Either element may be the held scratch copy.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] a     Address of the first stored element
+ * @param[in] b     Address of the second stored element
+ * @return          1 if a comes before b, otherwise 0
+ */
+int element_less(binary_heap_t* heap, const unsigned char* a, const unsigned char* b)
+{
+    HEAP_COUNT_COMPARISONS(heap, 1);
+
+    return element_order(heap, a, b);
+}
+
+/**
+ * Check whether a stored element comes before another without counting the
+ * comparison, for readers such as iterators that must not write to the heap.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] a     Address of the first stored element
+ * @param[in] b     Address of the second stored element
+ * @return          1 if a comes before b, otherwise 0
+ */
+int element_order(const binary_heap_t* heap, const unsigned char* a, const unsigned char* b)
+{
+    switch (heap->kind) {
+    case HEAP_POINTERS:
+        return heap->cmp(*(void* const*)a, *(void* const*)b) < 0;
+    case HEAP_KEYS:
+        return ((const heap_entry_t*)a)->key.u < ((const heap_entry_t*)b)->key.u;
+    case HEAP_KEYS_DOUBLE:
+        return ((const heap_entry_t*)a)->key.d < ((const heap_entry_t*)b)->key.d;
+    default:
+        return heap->cmp((void*)a, (void*)b) < 0;
+    }
+}
+
+/**
+ * Copy a stored element from one address to another.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] dst   Address to copy the element to
+ * @param[in] src   Address of the element to copy
+ */
+void element_move(binary_heap_t* heap, unsigned char* dst, const unsigned char* src)
+{
+    HEAP_STAT_ADD(heap, moves, 1);
+
+    switch (heap->kind) {
+    case HEAP_POINTERS:
+        *(void**)dst = *(void* const*)src;
+        break;
+    case HEAP_VALUES:
+        memcpy(dst, src, heap->elem_size);
+        break;
+    default:
+        *(heap_entry_t*)dst = *(const heap_entry_t*)src;
+        break;
+    }
+}
+
+/**
+ * Copy the element at index out to the held scratch element, leaving a
+ * hole for a sift.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] index The heap index of the element to hold
+ */
+void hold_element(binary_heap_t* heap, size_t index)
+{
+    element_move(heap, (unsigned char*)heap->scratch, HEAP_SLOT(heap, index));
+    HEAP_STAT_SIFT_START(heap, index);
+
+    if (heap->handles)
+        heap->held_handle = heap->handles[index];
+}
+
+/**
+ * Move the element at src into the hole at dst, keeping its handle
+ * position up to date.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] dst   The heap index of the hole
+ * @param[in] src   The heap index of the element to move
+ */
+void shift_element(binary_heap_t* heap, size_t dst, size_t src)
+{
+    element_move(heap, HEAP_SLOT(heap, dst), HEAP_SLOT(heap, src));
+
+    if (heap->handles) {
+        heap->handles[dst] = heap->handles[src];
+        heap->positions[heap->handles[dst]] = dst;
+    }
+}
+
+/**
+ * Move the held scratch element into the hole at index, ending a sift.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] index The heap index of the hole
+ */
+void place_held(binary_heap_t* heap, size_t index)
+{
+    element_move(heap, HEAP_SLOT(heap, index), (unsigned char*)heap->scratch);
+    HEAP_STAT_SIFT_END(heap, index);
+
+    if (heap->handles) {
+        heap->handles[index] = heap->held_handle;
+        heap->positions[heap->held_handle] = index;
+    }
+}
+
+/**
+ * Get the handle the next pushed element will be given, reusing the most
+ * recently freed handle first.
+ *
+ * @param[in] heap  The binary heap, with handle tracking enabled
+ * @return          The next handle
+ */
+binary_heap_handle_t next_handle(binary_heap_t* heap)
+{
+    return (heap->handle_count > heap->size ? heap->handles[heap->size] : heap->handle_count);
+}
+
+/**
+ * Give the element just stored at index, the end of the heap, a handle if
+ * handle tracking is enabled.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] index The heap index of the new element, equal to heap size
+ */
+void track_push(binary_heap_t* heap, size_t index)
+{
+    if (!heap->handles)
+        return;
+
+    /* Pushes bump size before calling, so take the free handle stack
+     * top from index rather than through next_handle */
+    binary_heap_handle_t handle = (heap->handle_count > index ? heap->handles[index] : heap->handle_count);
+    if (handle == heap->handle_count)
+        ++heap->handle_count;
+
+    heap->handles[index] = handle;
+    heap->positions[handle] = index;
+}
+
+/**
+ * Get the data element a caller sees for a stored element: the stored
+ * pointer, a pointer to the stored value, or the payload of a keyed entry.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] index The heap index of the element
+ * @return          The data element
+ */
+void* element(binary_heap_t* heap, size_t index)
+{
+    switch (heap->kind) {
+    case HEAP_POINTERS:
+        return HEAP_PTR(heap, index);
+    case HEAP_VALUES:
+        return HEAP_SLOT(heap, index);
+    default:
+        return HEAP_ENTRY(heap, index).payload;
+    }
+}
+
+/**
+ * Add a new entry to a keyed binary heap. Only the key matching the heap
+ * kind is used.
+ *
+ * @param[in] heap     The keyed binary heap
+ * @param[in] key      The unsigned key for HEAP_KEYS heaps
+ * @param[in] dkey     The double key for HEAP_KEYS_DOUBLE heaps
+ * @param[in] payload  The data element to add
+ * @return             1 if the add is successful, otherwise 0
+ */
+int push_keyed(binary_heap_t* heap, uint64_t key, double dkey, void* payload)
+{
+    if (!reserve(heap, 1))
+        return 0;
+
+    heap_entry_t* entry = &HEAP_ENTRY(heap, heap->size);
+    if (heap->kind == HEAP_KEYS)
+        entry->key.u = key;
+    else
+        entry->key.d = dkey;
+    entry->payload = payload;
+    track_push(heap, heap->size++);
+
+    bubble_up(heap, heap->size - 1);
+
+    return 1;
+}
+
+/**
+ * Find where elements start in a heap file, past the header and placed so
+ * that siblings start on a cache line once the page-aligned file is
+ * mapped, like allocated storage.
+ *
+ * @param[in] elem_size The size in bytes of each element
+ * @return              The offset of the first element
+ */
+size_t file_data_offset(size_t elem_size)
+{
+    size_t offset = sizeof(heap_file_header_t);
+    return (offset + (HEAP_CACHE_LINE - (offset + elem_size) % HEAP_CACHE_LINE) % HEAP_CACHE_LINE);
+}
+
+/**
+ * Move the elements of a loaded heap out of the file mapping into
+ * allocated storage for capacity elements, and unmap the file.
+ *
+ * @param[in] heap      The loaded binary heap
+ * @param[in] capacity  The number of elements to make room for, at least size
+ * @return              1 if the elements moved, otherwise 0 and the heap is unchanged
+ */
+int unmap_storage(binary_heap_t* heap, size_t capacity)
+{
+#if HEAP_FILES
+    size_t block_size = capacity * heap->elem_size + HEAP_CACHE_LINE;
+    unsigned char* block = (unsigned char*)heap_alloc(heap, block_size);
+    if (!block)
+        return 0;
+
+    size_t offset = (HEAP_CACHE_LINE - ((uintptr_t)block + heap->elem_size) % HEAP_CACHE_LINE) % HEAP_CACHE_LINE;
+    memcpy(block + offset, heap->data, heap->size * heap->elem_size);
+    munmap(heap->block, heap->block_size);
+
+    heap->block = block;
+    heap->block_size = block_size;
+    heap->mapped = 0;
+    heap->data = block + offset;
+    heap->capacity = capacity;
+    return 1;
+#else
+    (void)heap;
+    (void)capacity;
+    return 0;
+#endif
+}
+
+/**
+ * Make room in an iterator frontier for count indices.
+ *
+ * @param[in] iter  The iterator
+ * @param[in] count The number of indices needed
+ * @return          1 if there is room, otherwise 0 and the frontier is unchanged
+ */
+int frontier_reserve(binary_heap_iter_t* iter, size_t count)
+{
+    if (count <= iter->capacity)
+        return 1;
+
+    size_t capacity = (iter->capacity ? iter->capacity : 1);
+    while (capacity < count)
+        capacity <<= 1;
+
+    size_t* frontier = (size_t*)heap_realloc(iter->heap, iter->frontier, iter->capacity * sizeof(size_t),
+                                             capacity * sizeof(size_t));
+    if (!frontier)
+        return 0;
+
+    iter->frontier = frontier;
+    iter->capacity = capacity;
+    return 1;
+}
+
+/**
+ * Add a heap index to an iterator frontier, which must have room for it,
+ * and bubble it up by the element stored there.
+ *
+ * @param[in] iter  The iterator
+ * @param[in] index The heap index to add
+ */
+void frontier_push(binary_heap_iter_t* iter, size_t index)
+{
+    binary_heap_t* heap = iter->heap;
+    size_t* frontier = iter->frontier;
+    size_t at = iter->size++;
+
+    while (at > 0 && element_order(heap, HEAP_SLOT(heap, index), HEAP_SLOT(heap, frontier[(at - 1) / 2]))) {
+        frontier[at] = frontier[(at - 1) / 2];
+        at = (at - 1) / 2;
+    }
+    frontier[at] = index;
+}
+
+/**
+ * Remove the heap index of the best element from a non-empty iterator
+ * frontier.
+ *
+ * @param[in] iter  The iterator
+ * @return          The heap index removed
+ */
+size_t frontier_pop(binary_heap_iter_t* iter)
+{
+    binary_heap_t* heap = iter->heap;
+    size_t* frontier = iter->frontier;
+    size_t top = frontier[0];
+    size_t index = frontier[--iter->size];
+    size_t at = 0;
+
+    for (;;) {
+        size_t child = at * 2 + 1;
+        if (child >= iter->size)
+            break;
+        if (child + 1 < iter->size && element_order(heap, HEAP_SLOT(heap, frontier[child + 1]), HEAP_SLOT(heap, frontier[child])))
+            ++child;
+        if (!element_order(heap, HEAP_SLOT(heap, frontier[child]), HEAP_SLOT(heap, index)))
+            break;
+
+        frontier[at] = frontier[child];
+        at = child;
+    }
+    frontier[at] = index;
+
+    return top;
+}
+
+/**
+ * Pop cancelled elements off the top until a live one is there.
+ *
+ * @param[in] heap  The binary heap
+ */
+void skip_dead(binary_heap_t* heap)
+{
+    if (!heap->is_dead)
+        return;
+
+    while (heap->size && heap->is_dead(element(heap, 0))) {
+        pop_root(heap);
+        if (heap->dead)
+            --heap->dead;
+    }
+}
+
+/**
+ * Drop every cancelled element and re-heapify what is left, then shrink
+ * storage while it would be less than half full.
+ * O(n)
+ *
+ * @param[in] heap  The binary heap, with lazy deletion on
+ */
+void compact(binary_heap_t* heap)
+{
+    size_t live = 0;
+    size_t i;
+    for (i = 0; i < heap->size; ++i) {
+        if (heap->is_dead(element(heap, i)))
+            continue;
+        if (live != i)
+            element_move(heap, HEAP_SLOT(heap, live), HEAP_SLOT(heap, i));
+        ++live;
+    }
+
+    heap->size = live;
+    heap->dead = 0;
+    binary_heap_heapify(heap);
+
+    /* Bounded heaps keep their storage. A failed shrink changes nothing. */
+    size_t capacity = heap->capacity;
+    while (capacity / 2 >= BINARY_HEAP_INITIAL_CAPACITY && capacity / 2 >= live)
+        capacity /= 2;
+    if (capacity < heap->capacity && !heap->bound)
+        storage_grow(heap, capacity);
+}
+
+/**
+ * Find the radix bucket of a key, 0 if it equals last, otherwise one past
+ * the highest bit in which it differs from last.
+ *
+ * @param[in] key   The key
+ * @param[in] last  The last popped key, at most key
+ * @return          The bucket index
+ */
+size_t radix_bucket(uint64_t key, uint64_t last)
+{
+    uint64_t diff = key ^ last;
+#if defined(__GNUC__)
+    return (diff ? (size_t)(64 - __builtin_clzll(diff)) : 0);
+#else
+    size_t bucket = 0;
+    for (; diff; diff >>= 1)
+        ++bucket;
+    return bucket;
+#endif
+}
+
+/**
+ * Make room for count more entries in a radix bucket, doubling its
+ * capacity from BINARY_HEAP_INITIAL_CAPACITY.
+ *
+ * @param[in] heap      The radix heap
+ * @param[in] bucket    The bucket index
+ * @param[in] count     The number of entries to make room for
+ * @return              1 if there is room, otherwise 0 and the bucket is unchanged
+ */
+int radix_reserve(binary_heap_t* heap, size_t bucket, size_t count)
+{
+    heap_radix_t* radix = heap->radix;
+    size_t old_capacity = radix->capacities[bucket];
+    if (radix->counts[bucket] + count <= old_capacity)
+        return 1;
+
+    size_t capacity = (old_capacity ? old_capacity : BINARY_HEAP_INITIAL_CAPACITY);
+    while (capacity < radix->counts[bucket] + count)
+        capacity *= 2;
+
+    void* entries = heap_realloc(heap, radix->buckets[bucket], old_capacity * sizeof(heap_entry_t),
+                                 capacity * sizeof(heap_entry_t));
+    if (!entries)
+        return 0;
+
+    if (radix->buckets[bucket]) {
+        HEAP_STAT_ADD(heap, resizes, 1);
+        HEAP_STAT_ADD(heap, bytes_reallocated, capacity * sizeof(heap_entry_t));
+    }
+
+    radix->buckets[bucket] = (heap_entry_t*)entries;
+    radix->capacities[bucket] = capacity;
+    heap->capacity += capacity - old_capacity;
+    return 1;
+}
+
+/**
+ * Add an entry to the bucket for its key.
+ * O(1)
+ *
+ * @param[in] heap     The radix heap
+ * @param[in] key      The priority of the element, at least the last popped key
+ * @param[in] payload  The data element to add
+ * @return             1 if the add is successful, otherwise 0
+ */
+int radix_push(binary_heap_t* heap, uint64_t key, void* payload)
+{
+    heap_radix_t* radix = heap->radix;
+    assert(key >= radix->last && "Radix heap keys must not go below the last popped key");
+
+    size_t bucket = radix_bucket(key, radix->last);
+    if (!radix_reserve(heap, bucket, 1))
+        return 0;
+
+    heap_entry_t* entry = &radix->buckets[bucket][radix->counts[bucket]++];
+    entry->key.u = key;
+    entry->payload = payload;
+    ++heap->size;
+    HEAP_STAT_MAX(heap, max_size, heap->size);
+
+    return 1;
+}
+
+/**
+ * Remove an entry with the smallest key.
+ * O(log C) amortized
+ *
+ * @param[in]  heap The radix heap
+ * @param[out] out  The out ptr to the removed payload, untouched if none
+ * @return          1 if an entry was removed, otherwise 0
+ */
+int radix_pop(binary_heap_t* heap, void** out)
+{
+    if (!radix_settle(heap))
+        return 0;
+
+    heap_radix_t* radix = heap->radix;
+    *out = radix->buckets[0][--radix->counts[0]].payload;
+    --heap->size;
+
+    return 1;
+}
+
+/**
+ * Make sure bucket 0 holds the smallest keys. When it is empty, the
+ * smallest key of the lowest non-empty bucket becomes last and that
+ * bucket's entries move down to the buckets for the new last. They all
+ * land in lower buckets, so each entry moves at most 64 times. Room is
+ * made for every move first, so a failed allocation changes nothing.
+ *
+ * @param[in] heap  The radix heap
+ * @return          1 if bucket 0 is non-empty, otherwise 0
+ */
+int radix_settle(binary_heap_t* heap)
+{
+    heap_radix_t* radix = heap->radix;
+    if (radix->counts[0])
+        return 1;
+    if (heap->size == 0)
+        return 0;
+
+    size_t bucket = 1;
+    while (!radix->counts[bucket])
+        ++bucket;
+
+    heap_entry_t* entries = radix->buckets[bucket];
+    size_t count = radix->counts[bucket];
+    uint64_t last = entries[0].key.u;
+    size_t i;
+    for (i = 1; i < count; ++i) {
+        if (entries[i].key.u < last)
+            last = entries[i].key.u;
+    }
+    HEAP_COUNT_COMPARISONS(heap, count - 1);
+
+    size_t moving[HEAP_RADIX_BUCKETS];
+    memset(moving, 0, sizeof(moving));
+    for (i = 0; i < count; ++i)
+        ++moving[radix_bucket(entries[i].key.u, last)];
+
+    size_t b;
+    for (b = 0; b < bucket; ++b) {
+        if (moving[b] && !radix_reserve(heap, b, moving[b]))
+            return 0;
+    }
+
+    for (i = 0; i < count; ++i) {
+        b = radix_bucket(entries[i].key.u, last);
+        radix->buckets[b][radix->counts[b]++] = entries[i];
+    }
+
+    radix->counts[bucket] = 0;
+    radix->last = last;
+    return 1;
+}
+
+/**
+ * Reallocate heap storage to hold capacity elements, keeping the stored
+ * elements and re-aligning them if the block moved. Siblings [di+1, di+d]
+ * start on a cache line when data + elem_size does, so the data offset is
+ * picked to make that true.
+ *
+ * @param[in] heap      The binary heap
+ * @param[in] capacity  The number of elements to make room for
+ * @return              1 if the reallocation succeeds, otherwise 0 and the heap is unchanged
+ */
+int storage_grow(binary_heap_t* heap, size_t capacity)
+{
+    if (capacity > (HEAP_CAPACITY_MAX - HEAP_CACHE_LINE) / heap->elem_size)
+        return 0;
+
+    if (heap->mapped)
+        return unmap_storage(heap, capacity);
+
+    /* Handle arrays grow first, each kept as soon as it is reallocated */
+    if (heap->handles) {
+        void* positions = heap_realloc(heap, heap->positions, heap->capacity * sizeof(size_t), capacity * sizeof(size_t));
+        if (!positions)
+            return 0;
+        heap->positions = (size_t*)positions;
+
+        void* handles = heap_realloc(heap, heap->handles, heap->capacity * sizeof(binary_heap_handle_t),
+                                     capacity * sizeof(binary_heap_handle_t));
+        if (!handles)
+            return 0;
+        heap->handles = (binary_heap_handle_t*)handles;
+    }
+
+    size_t old_offset = (size_t)(heap->data - (unsigned char*)heap->block);
+
+    size_t block_size = capacity * heap->elem_size + HEAP_CACHE_LINE;
+    unsigned char* block = (unsigned char*)heap_realloc(heap, heap->block, heap->block_size, block_size);
+    if (!block)
+        return 0;
+
+    size_t offset = (HEAP_CACHE_LINE - ((uintptr_t)block + heap->elem_size) % HEAP_CACHE_LINE) % HEAP_CACHE_LINE;
+    if (offset != old_offset)
+        memmove(block + offset, block + old_offset, heap->size * heap->elem_size);
+
+    /* The first allocation is not a resize */
+    if (heap->block) {
+        HEAP_STAT_ADD(heap, resizes, 1);
+        HEAP_STAT_ADD(heap, bytes_reallocated, block_size);
+    }
+
+    heap->block = block;
+    heap->block_size = block_size;
+    heap->data = block + offset;
+    heap->capacity = capacity;
+
+    return 1;
+}
+
+/**
+ * Allocate a new heap object of the given kind with room for capacity
+ * elements. A capacity of 0 leaves storage empty for the caller to fill.
+ *
+ * @param[in] cmp       The comparitor function pointer, NULL for keyed heaps
+ * @param[in] kind      The heap storage kind
+ * @param[in] elem_size The size in bytes of a stored element
+ * @param[in] capacity  The number of elements to make room for
+ * @param[in] allocator The allocator for all heap state
+ * @param[in] ctx       The allocator context
+ * @return              The new heap, otherwise NULL
+ */
+binary_heap_t* create(compare_f cmp, int kind, size_t elem_size, size_t capacity,
+                      const binary_heap_allocator_t* allocator, void* ctx)
+{
+    binary_heap_t* heap = (binary_heap_t*)allocator->alloc(ctx, sizeof(binary_heap_t));
+
+    assert(heap);
+    if (!heap)
+        return NULL;
+
+    heap->cmp = cmp;
+    heap->kind = kind;
+    heap->elem_size = elem_size;
+    heap->allocator = allocator;
+    heap->allocator_ctx = ctx;
+    heap->block = NULL;
+    heap->block_size = 0;
+    heap->mapped = 0;
+    heap->data = NULL;
+    heap->size = 0;
+    heap->capacity = 0;
+    heap->bottom_up = BINARY_HEAP_BOTTOM_UP;
+    heap->simd = (kind == HEAP_KEYS ? simd_level() : HEAP_SIMD_NONE);
+    heap->comparisons = 0;
+    heap->bound = 0;
+    heap->radix = NULL;
+    heap->is_dead = NULL;
+    heap->dead = 0;
+    heap->compact_at = 1.0;
+#if BINARY_HEAP_STATS
+    memset(&heap->stats, 0, sizeof(heap->stats));
+#endif
+    heap->positions = NULL;
+    heap->handles = NULL;
+    heap->handle_count = 0;
+    heap->scratch = (kind == HEAP_VALUES ? heap_alloc(heap, elem_size) : (void*)&heap->held);
+
+    assert(heap->scratch);
+    if (!heap->scratch || (capacity > 0 && !storage_grow(heap, capacity))) {
+        binary_heap_destroy(heap);
+        return NULL;
+    }
+
+    return heap;
+}
+
+/**
+ * Heapify the subtrees under the nodes [first, last) of one level. The
+ * descendants of a run of nodes at each depth are themselves a run, so
+ * the subtrees are sifted a whole depth at a time, deepest first.
+ *
+ * @param[in] heap  The binary heap, or a worker's view of it
+ * @param[in] first The first subtree root
+ * @param[in] last  One past the last subtree root
+ */
+void heapify_range(binary_heap_t* heap, size_t first, size_t last)
+{
+    if (heap->size < 2 || first >= last)
+        return;
+
+    size_t parents = HEAP_PARENT(heap->size - 1) + 1;
+    size_t depth = 0, lo = first;
+    while (lo < parents) {
+        lo = lo * BINARY_HEAP_ARITY + 1;
+        ++depth;
+    }
+
+    while (depth-- > 0) {
+        size_t hi = last, d;
+        lo = first;
+        for (d = 0; d < depth; ++d) {
+            lo = lo * BINARY_HEAP_ARITY + 1;
+            hi = hi * BINARY_HEAP_ARITY + 1;
+        }
+
+        if (hi > parents)
+            hi = parents;
+        while (hi-- > lo)
+            bubble_down(heap, hi);
+    }
+}
+
+/**
+ * Thread entry point for a parallel heapify worker.
+ *
+ * @param[in] arg   The heap_worker_t
+ * @return          NULL
+ */
+void* heapify_worker(void* arg)
+{
+    heap_worker_t* worker = (heap_worker_t*)arg;
+    heapify_range(&worker->view, worker->first, worker->last);
+    return NULL;
+}
+
+/**
+ * Allocate heap state with the heap's allocator.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] size  The number of bytes to allocate
+ * @return          The allocation, otherwise NULL
+ */
+void* heap_alloc(binary_heap_t* heap, size_t size)
+{
+    return (heap->allocator->alloc(heap->allocator_ctx, size));
+}
+
+/**
+ * Reallocate heap state with the heap's allocator. A NULL ptr allocates.
+ *
+ * @param[in] heap      The binary heap
+ * @param[in] ptr       The allocation to resize, may be NULL
+ * @param[in] old_size  The current size of the allocation
+ * @param[in] new_size  The number of bytes to resize to
+ * @return              The resized allocation, otherwise NULL and ptr is unchanged
+ */
+void* heap_realloc(binary_heap_t* heap, void* ptr, size_t old_size, size_t new_size)
+{
+    if (!ptr)
+        return (heap_alloc(heap, new_size));
+
+    return (heap->allocator->realloc(heap->allocator_ctx, ptr, old_size, new_size));
+}
+
+/**
+ * Free heap state with the heap's allocator. A NULL ptr is ignored.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] ptr   The allocation to free, may be NULL
+ * @param[in] size  The size of the allocation
+ */
+void heap_free(binary_heap_t* heap, void* ptr, size_t size)
+{
+    if (ptr)
+        heap->allocator->free(heap->allocator_ctx, ptr, size);
+}
+
+/* Default allocator, BINARY_HEAP_ALLOC et al. ignore the context and sizes */
+void* default_alloc(void* ctx, size_t size)
+{
+    (void)ctx;
+    return (BINARY_HEAP_ALLOC(size));
+}
+
+void* default_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size)
+{
+    (void)ctx;
+    (void)old_size;
+    return (BINARY_HEAP_REALLOC(ptr, new_size));
+}
+
+void default_free(void* ctx, void* ptr, size_t size)
+{
+    (void)ctx;
+    (void)size;
+    BINARY_HEAP_FREE(ptr);
+}
+
+/**
+ * Count a sift that moved an element from one index to another in the
+ * sift depth histogram. Only used when built with BINARY_HEAP_STATS.
+ *
+ * @param[in] heap  The binary heap
+ * @param[in] from  The heap index the element started at
+ * @param[in] to    The heap index the element ended at
+ */
+void record_sift(binary_heap_t* heap, size_t from, size_t to)
+{
+#if BINARY_HEAP_STATS
+    size_t depth = 0;
+
+    /* Levels between the two, one of them is an ancestor of the other */
+    while (from > to) {
+        from = HEAP_PARENT(from);
+        ++depth;
+    }
+    while (to > from) {
+        to = HEAP_PARENT(to);
+        ++depth;
+    }
+
+    size_t bucket = 0;
+    while (depth > 0 && bucket < BINARY_HEAP_STATS_BUCKETS - 1) {
+        depth >>= 1;
+        ++bucket;
+    }
+
+    ++heap->stats.sift_depth[bucket];
+#else
+    (void)heap;
+    (void)from;
+    (void)to;
+#endif
 }
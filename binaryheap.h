@@ -23,23 +23,58 @@
 extern "C" {
 #endif
 
-/* 
- * TODO:
- * - Needs benchmarking
- * - Implement better traversal functionality
- */
-
-
 /* Override to change heap resizing. Heaps resize doubles capacity. */
 #ifndef BINARY_HEAP_RESIZE
 #define BINARY_HEAP_RESIZE 1
 #endif
 
+/* Number of children per node. Wider heaps are shallower, so pops touch
+ * fewer cache lines at the cost of more comparisons per level. */
+#ifndef BINARY_HEAP_ARITY
+#define BINARY_HEAP_ARITY 2
+#endif
+
+/* Override to pop with bottom-up sifts by default, which roughly halves
+ * comparisons per pop. See binary_heap_set_bottom_up. */
+#ifndef BINARY_HEAP_BOTTOM_UP
+#define BINARY_HEAP_BOTTOM_UP 0
+#endif
+
+/* Override to 1 to count per-heap operation stats, see binary_heap_stats.
+ * When 0 the counters compile away entirely. */
+#ifndef BINARY_HEAP_STATS
+#define BINARY_HEAP_STATS 0
+#endif
+
+/* Override to 1 to count element comparisons, see binary_heap_comparisons.
+ * Counting writes to the heap on every comparison, so it is off unless
+ * asked for here or stats are on. */
+#ifndef BINARY_HEAP_COUNT_COMPARISONS
+#define BINARY_HEAP_COUNT_COMPARISONS BINARY_HEAP_STATS
+#endif
+
+/* Override to 0 to never pick children with SIMD. Otherwise keyed heaps
+ * with a BINARY_HEAP_ARITY of 4, 8 or 16 compare a node's children in
+ * AVX2 or SSE4.2 registers when the CPU has them. See binary_heap_set_simd. */
+#ifndef BINARY_HEAP_SIMD
+#define BINARY_HEAP_SIMD 1
+#endif
+
+/* Override to 1 to let binary_heap_heapify_parallel run on pthreads,
+ * which then needs linking with -pthread. When 0 it heapifies on the
+ * calling thread. */
+#ifndef BINARY_HEAP_THREADS
+#define BINARY_HEAP_THREADS 0
+#endif
+
 /* Starting heap size */
 #ifndef BINARY_HEAP_INITIAL_CAPACITY
 #define BINARY_HEAP_INITIAL_CAPACITY 20
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
+
 /* Override to avoid malloc */
 #ifndef BINARY_HEAP_ALLOC
 #include <stdlib.h>
@@ -50,14 +85,57 @@ extern "C" {
 
 /* Forward declare */
 typedef struct binary_heap binary_heap_t;
+typedef struct binary_heap_iter binary_heap_iter_t;
 
 /* Comparitor function pointer */
 typedef int (*compare_f)(void*, void*);
 /* Visitor function pointer */
 typedef void (*visit_f)(void*);
+/* Lazy deletion predicate, non-zero for cancelled elements */
+typedef int (*dead_f)(void*);
+
+/* Per-heap allocator. Sizes are those of the original allocations, so
+ * allocators without a size header (arenas, pools) can use them. */
+typedef struct binary_heap_allocator {
+    void* (*alloc)  (void* ctx, size_t size);
+    void* (*realloc)(void* ctx, void* ptr, size_t old_size, size_t new_size);
+    void  (*free)   (void* ctx, void* ptr, size_t size);
+} binary_heap_allocator_t;
+
+/* Sift depth histogram buckets, bucket b > 0 counts sifts that moved
+ * [2^(b-1), 2^b) levels and bucket 0 sifts that did not move */
+#define BINARY_HEAP_STATS_BUCKETS 8
+
+/* Operation stats, filled in when built with BINARY_HEAP_STATS, which also
+ * counts comparisons */
+typedef struct binary_heap_stats {
+    size_t comparisons;
+    size_t moves;
+    size_t resizes;
+    size_t bytes_reallocated;
+    size_t max_size;
+    size_t sift_depth[BINARY_HEAP_STATS_BUCKETS];
+} binary_heap_stats_t;
+
+/* Stable element handle for heaps with handle tracking */
+typedef size_t binary_heap_handle_t;
+#define BINARY_HEAP_NO_HANDLE ((binary_heap_handle_t) - 1)
 
 
 void 	binary_heap_new           (binary_heap_t** out, compare_f cmp);
+void 	binary_heap_new_with_allocator(binary_heap_t** out, compare_f cmp, const binary_heap_allocator_t* allocator, void* ctx);
+void 	binary_heap_new_from_array(binary_heap_t** out, compare_f cmp, void** data, size_t size);
+void 	binary_heap_adopt_array   (binary_heap_t** out, compare_f cmp, void** data, size_t size, size_t capacity);
+void 	binary_heap_new_sized     (binary_heap_t** out, size_t elem_size, compare_f cmp);
+void 	binary_heap_new_keyed     (binary_heap_t** out);
+void 	binary_heap_new_keyed_double(binary_heap_t** out);
+void 	binary_heap_new_radix     (binary_heap_t** out);
+void 	binary_heap_new_bounded   (binary_heap_t** out, compare_f cmp, size_t k);
+void 	binary_heap_new_keyed_bounded(binary_heap_t** out, size_t k);
+
+/* Sized heaps only, POSIX only, fail elsewhere */
+int 	binary_heap_save          (binary_heap_t* heap, const char* path);
+int 	binary_heap_load          (binary_heap_t** out, const char* path, size_t elem_size, compare_f cmp);
 
 void 	binary_heap_destroy       (binary_heap_t* heap);
 void 	binary_heap_destroy_free  (binary_heap_t* heap);
@@ -67,10 +145,65 @@ size_t 	binary_heap_capacity      (binary_heap_t* heap);
 
 void 	binary_heap_traverse      (binary_heap_t* heap, visit_f visit);
 
+/* Priority order without modifying the heap, see binary_heap_iter_new */
+int 	binary_heap_iter_new      (binary_heap_iter_t** out, binary_heap_t* heap, size_t k);
+int 	binary_heap_iter_next     (binary_heap_iter_t* iter, void** out);
+void 	binary_heap_iter_destroy  (binary_heap_iter_t* iter);
+
 int 	binary_heap_push          (binary_heap_t* heap, void* data);
 void 	binary_heap_pop           (binary_heap_t* heap, void** out);
 void 	binary_heap_peek          (binary_heap_t* heap, void** out);
 
+/* Sized heaps only, elements are copied in and out by value */
+int 	binary_heap_push_value    (binary_heap_t* heap, const void* elem);
+int 	binary_heap_pop_value     (binary_heap_t* heap, void* out);
+int 	binary_heap_replace_value (binary_heap_t* heap, const void* elem, void* out);
+
+/* Keyed heaps only, pop and peek return the payload. Radix heaps support
+ * push_key and peek_key, see binary_heap_new_radix. */
+int 	binary_heap_push_key      (binary_heap_t* heap, uint64_t key, void* payload);
+int 	binary_heap_push_key_double(binary_heap_t* heap, double key, void* payload);
+int 	binary_heap_peek_key      (binary_heap_t* heap, uint64_t* out);
+int 	binary_heap_peek_key_double(binary_heap_t* heap, double* out);
+int 	binary_heap_pushpop_key   (binary_heap_t* heap, uint64_t key, void* payload, void** out);
+int 	binary_heap_replace_key   (binary_heap_t* heap, uint64_t key, void* payload, void** out);
+
+int 	binary_heap_push_n        (binary_heap_t* heap, void** data, size_t count);
+size_t	binary_heap_pop_n         (binary_heap_t* heap, void** out, size_t count);
+int 	binary_heap_merge         (binary_heap_t* dst, binary_heap_t* src);
+int 	binary_heap_pushpop       (binary_heap_t* heap, void* data, void** out);
+int 	binary_heap_replace       (binary_heap_t* heap, void* data, void** out);
+void*	binary_heap_drain_sorted  (binary_heap_t* heap, size_t* count);
+void*	binary_heap_drain_partial (binary_heap_t* heap, size_t k, size_t* count);
+void*	binary_heap_sort_in_place (binary_heap_t* heap, size_t* count);
+void 	binary_heap_clear         (binary_heap_t* heap);
+int 	binary_heap_reserve       (binary_heap_t* heap, size_t count);
+
+/* Bounded heaps only */
+int 	binary_heap_offer         (binary_heap_t* heap, void* data, void** evicted);
+int 	binary_heap_offer_key     (binary_heap_t* heap, uint64_t key, void* payload, void** evicted);
+
+void 	binary_heap_heapify       (binary_heap_t* heap);
+void 	binary_heap_heapify_parallel(binary_heap_t* heap, size_t threads);
+
+void 	binary_heap_set_bottom_up (binary_heap_t* heap, int enabled);
+int 	binary_heap_set_simd      (binary_heap_t* heap, int enabled);
+void 	binary_heap_set_tombstones(binary_heap_t* heap, dead_f is_dead, double compact_at);
+void 	binary_heap_cancel        (binary_heap_t* heap, void* data);
+size_t	binary_heap_comparisons   (binary_heap_t* heap);
+int 	binary_heap_stats         (binary_heap_t* heap, binary_heap_stats_t* out);
+
+/* Handle tracking, for pointer and keyed heaps */
+int 	binary_heap_track_handles (binary_heap_t* heap);
+binary_heap_handle_t binary_heap_push_handle(binary_heap_t* heap, void* data);
+binary_heap_handle_t binary_heap_push_key_handle(binary_heap_t* heap, uint64_t key, void* payload);
+binary_heap_handle_t binary_heap_push_key_double_handle(binary_heap_t* heap, double key, void* payload);
+int 	binary_heap_contains      (binary_heap_t* heap, binary_heap_handle_t handle);
+void 	binary_heap_update        (binary_heap_t* heap, binary_heap_handle_t handle);
+void 	binary_heap_update_key    (binary_heap_t* heap, binary_heap_handle_t handle, uint64_t key);
+void 	binary_heap_update_key_double(binary_heap_t* heap, binary_heap_handle_t handle, double key);
+void 	binary_heap_remove        (binary_heap_t* heap, binary_heap_handle_t handle, void** out);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,386 @@
+/*
+ * binaryheap.hpp
+ * Copyright (C) 2016-2017 Chad Mowery
+ *
+ *
+ * binaryheap.hpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * binaryheap.hpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BINARY_HEAP_HPP
+#define BINARY_HEAP_HPP
+
+/* Shares BINARY_HEAP_ARITY, BINARY_HEAP_INITIAL_CAPACITY and
+ * BINARY_HEAP_RESIZE with the C implementation */
+#include "binaryheap.h"
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace binaryheap {
+
+/**
+ * Header-only binary heap storing T by value. Uses the same d-ary layout
+ * and doubling growth as binaryheap.c, but the comparator is a template
+ * parameter so it can be inlined, and sifts move each element into a hole
+ * instead of swapping, so move-only types are supported.
+ *
+ * Compare(a, b) returning true means a comes out of the heap before b, so
+ * the default std::less<T> gives a min heap, like the C comparitors with
+ * cmp(a, b) < 0. Note this is the opposite of std::priority_queue.
+ *
+ * Lives in namespace binaryheap, since ::binary_heap is the C struct.
+ */
+template <typename T, typename Compare = std::less<T>, typename Alloc = std::allocator<T> >
+class binary_heap
+{
+public:
+    typedef T           value_type;
+    typedef std::size_t size_type;
+
+    explicit binary_heap(const Compare& cmp = Compare(), const Alloc& alloc = Alloc())
+        : cmp_(cmp), alloc_(alloc), data_(nullptr), size_(0), capacity_(0)
+    {
+    }
+
+    binary_heap(const binary_heap& other)
+        : cmp_(other.cmp_), alloc_(traits::select_on_container_copy_construction(other.alloc_)),
+          data_(nullptr), size_(0), capacity_(0)
+    {
+        if (!reserve(other.size_))
+            throw std::bad_alloc();
+
+        try {
+            for (; size_ < other.size_; ++size_)
+                traits::construct(alloc_, data_ + size_, other.data_[size_]);
+        }
+        catch (...) {
+            clear();
+            if (data_)
+                traits::deallocate(alloc_, data_, capacity_);
+            throw;
+        }
+    }
+
+    binary_heap(binary_heap&& other) noexcept
+        : cmp_(std::move(other.cmp_)), alloc_(std::move(other.alloc_)), data_(other.data_), size_(other.size_), capacity_(other.capacity_)
+    {
+        other.data_ = nullptr;
+        other.size_ = other.capacity_ = 0;
+    }
+
+    binary_heap& operator=(binary_heap other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~binary_heap()
+    {
+        clear();
+        if (data_)
+            traits::deallocate(alloc_, data_, capacity_);
+    }
+
+    void swap(binary_heap& other) noexcept
+    {
+        using std::swap;
+        swap(cmp_, other.cmp_);
+        swap(alloc_, other.alloc_);
+        swap(data_, other.data_);
+        swap(size_, other.size_);
+        swap(capacity_, other.capacity_);
+    }
+
+    /**
+     * Get the heap size.
+     * O(1)
+     */
+    size_type size() const     { return size_; }
+    bool      empty() const    { return size_ == 0; }
+
+    /**
+     * Get the heap capacity.
+     * O(1)
+     */
+    size_type capacity() const { return capacity_; }
+
+    /**
+     * Peek at the top-most element.
+     * O(1)
+     *
+     * @return  Pointer to the top-most element if exists, otherwise nullptr
+     */
+    const T* peek() const      { return size_ ? data_ : nullptr; }
+
+    /**
+     * Get the top-most element. The heap must not be empty.
+     * O(1)
+     */
+    const T& top() const
+    {
+        assert(size_);
+        return *data_;
+    }
+
+    /**
+     * Traverse the entire heap in array order.
+     * O(n)
+     */
+    template <typename Visit>
+    void traverse(Visit visit) const
+    {
+        for (size_type i = 0; i < size_; ++i)
+            visit(data_[i]);
+    }
+
+    /**
+     * Add a new element.
+     * O(logn)
+     *
+     * @return  true if the add is successful, otherwise false
+     */
+    bool push(const T& value)  { return emplace(value); }
+    bool push(T&& value)       { return emplace(std::move(value)); }
+
+    /**
+     * Construct a new element in place.
+     * O(logn)
+     *
+     * @return  true if the add is successful, otherwise false
+     */
+    template <typename... Args>
+    bool emplace(Args&&... args)
+    {
+        if (size_ == capacity_) {
+            if (!grow_emplace(std::forward<Args>(args)...))
+                return false;
+        }
+        else {
+            traits::construct(alloc_, data_ + size_, std::forward<Args>(args)...);
+        }
+
+        sift_up(size_++);
+        return true;
+    }
+
+    /**
+     * Remove the top-most element, moving it into out.
+     * O(logn)
+     *
+     * @return  true if an element was removed, otherwise false if the heap is empty
+     */
+    bool pop(T& out)
+    {
+        if (!size_)
+            return false;
+
+        out = std::move(*data_);
+        pop();
+        return true;
+    }
+
+    /**
+     * Remove the top-most element. The heap must not be empty.
+     * O(logn)
+     */
+    void pop()
+    {
+        assert(size_);
+
+        if (--size_ > 0)
+            sift_down(0, std::move(data_[size_]));
+        traits::destroy(alloc_, data_ + size_);
+    }
+
+    /**
+     * Make sure the heap has room for count elements.
+     *
+     * @return  true if there is enough room, otherwise false
+     */
+    bool reserve(size_type count)
+    {
+        return count <= capacity_ || grow(count);
+    }
+
+    /**
+     * Remove every element, keeping the capacity.
+     */
+    void clear()
+    {
+        for (size_type i = 0; i < size_; ++i)
+            traits::destroy(alloc_, data_ + i);
+        size_ = 0;
+    }
+
+private:
+    typedef std::allocator_traits<Alloc> traits;
+
+    static size_type parent(size_type i)      { return (i - 1) / BINARY_HEAP_ARITY; }
+    static size_type first_child(size_type i) { return i * BINARY_HEAP_ARITY + 1; }
+
+    /**
+     * Grow capacity by doubling until it holds count elements.
+     */
+    bool grow(size_type count)
+    {
+        size_type new_capacity;
+        T* new_data = allocate_grown(count, new_capacity);
+        if (!new_data)
+            return false;
+
+        relocate(new_data, new_capacity);
+        return true;
+    }
+
+    /**
+     * Grow a full heap and construct a new element at the end. Like
+     * std::vector, the element is constructed in the new storage before
+     * the old elements are moved, so args may refer to them.
+     */
+    template <typename... Args>
+    bool grow_emplace(Args&&... args)
+    {
+        size_type new_capacity;
+        T* new_data = allocate_grown(size_ + 1, new_capacity);
+        if (!new_data)
+            return false;
+
+        try {
+            traits::construct(alloc_, new_data + size_, std::forward<Args>(args)...);
+        }
+        catch (...) {
+            traits::deallocate(alloc_, new_data, new_capacity);
+            throw;
+        }
+
+        relocate(new_data, new_capacity);
+        return true;
+    }
+
+    /**
+     * Allocate storage for at least count elements, doubling the current
+     * capacity up to the allocator's max_size.
+     *
+     * @return  The new storage, otherwise nullptr if the heap may not grow,
+     *          count is past max_size or the allocation failed
+     */
+    T* allocate_grown(size_type count, size_type& new_capacity)
+    {
+        if (capacity_ && !BINARY_HEAP_RESIZE)
+            return nullptr;
+
+        /* Stop doubling before we overflow */
+        size_type max_capacity = traits::max_size(alloc_);
+        if (count > max_capacity)
+            return nullptr;
+
+        new_capacity = capacity_ ? capacity_ : BINARY_HEAP_INITIAL_CAPACITY;
+        while (new_capacity < count)
+            new_capacity = new_capacity > max_capacity / 2 ? max_capacity : new_capacity << 1;
+
+        try {
+            return traits::allocate(alloc_, new_capacity);
+        }
+        catch (const std::bad_alloc&) {
+            return nullptr;
+        }
+    }
+
+    /**
+     * Move the elements into new storage and free the old storage.
+     */
+    void relocate(T* new_data, size_type new_capacity)
+    {
+        for (size_type i = 0; i < size_; ++i) {
+            traits::construct(alloc_, new_data + i, std::move_if_noexcept(data_[i]));
+            traits::destroy(alloc_, data_ + i);
+        }
+
+        if (data_)
+            traits::deallocate(alloc_, data_, capacity_);
+
+        data_ = new_data;
+        capacity_ = new_capacity;
+    }
+
+    /**
+     * Move the element at index up to its place, shifting parents down into
+     * the hole so the element itself is only moved once.
+     */
+    void sift_up(size_type index)
+    {
+        if (index == 0 || !cmp_(data_[index], data_[parent(index)]))
+            return;
+
+        T value(std::move(data_[index]));
+        do {
+            size_type p = parent(index);
+            data_[index] = std::move(data_[p]);
+            index = p;
+        } while (index > 0 && cmp_(value, data_[parent(index)]));
+
+        data_[index] = std::move(value);
+    }
+
+    /**
+     * Place value into the hole at index. The hole first walks down to a
+     * leaf along the best child path, then value is sifted up from there.
+     * The value popped into the root usually belongs near the bottom, so
+     * this needs about half the comparisons of a top-down sift.
+     */
+    void sift_down(size_type index, T&& value)
+    {
+        size_type top = index;
+
+        for (;;) {
+            size_type child = first_child(index);
+            if (child >= size_)
+                break;
+
+            size_type last = child + BINARY_HEAP_ARITY;
+            if (last > size_)
+                last = size_;
+
+            size_type best = child;
+            for (++child; child < last; ++child) {
+                if (cmp_(data_[child], data_[best]))
+                    best = child;
+            }
+
+            data_[index] = std::move(data_[best]);
+            index = best;
+        }
+
+        while (index > top && cmp_(value, data_[parent(index)])) {
+            size_type p = parent(index);
+            data_[index] = std::move(data_[p]);
+            index = p;
+        }
+
+        data_[index] = std::move(value);
+    }
+
+    Compare   cmp_;
+    Alloc     alloc_;
+    T*        data_;
+    size_type size_;
+    size_type capacity_;
+};
+
+} /* namespace binaryheap */
+
+#endif /* BINARY_HEAP_HPP */
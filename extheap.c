@@ -0,0 +1,546 @@
+/*
+ * extheap.c
+ * Copyright (C) 2016-2017 Chad Mowery
+ *
+ * 
+ * extheap.c is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * extheap.c is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "extheap.h"
+
+/* Uncomment to disable asserts
+ * #define NDEBUG */
+#include <assert.h>
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Sorted run on disk, read back block by block. Elements [next, buffered)
+ * of buffer are read but not yet popped, remaining are still on disk.
+ */
+typedef struct extheap_run {
+    FILE*          file;
+    char*          path;
+    unsigned char* buffer;
+    size_t         next;
+    size_t         buffered;
+    size_t         remaining;
+    size_t         count;
+} extheap_run_t;
+
+struct extheap {
+    compare_f cmp;
+    size_t    elem_size;
+
+    /* Elements kept in memory before spilling, and per run read block */
+    size_t    memory_limit;
+    size_t    block;
+
+    binary_heap_t* memory;
+    extheap_run_t  runs[EXTHEAP_MAX_RUNS];
+    size_t         run_count;
+
+    char*         dir;
+    unsigned long run_seq;
+    size_t        size;
+};
+
+/* Forware declarations */
+int  open_run     (extheap_t* ext, extheap_run_t* run);
+void close_run    (extheap_t* ext, extheap_run_t* run);
+int  start_reading(extheap_t* ext, extheap_run_t* run, size_t count);
+void rewind_run   (extheap_t* ext, extheap_run_t* run, size_t consumed);
+int  run_head     (extheap_t* ext, extheap_run_t* run, unsigned char** head);
+void advance_run  (extheap_t* ext, size_t index);
+int  best_head    (extheap_t* ext, size_t* from, unsigned char** best);
+int  spill        (extheap_t* ext);
+int  merge_runs   (extheap_t* ext, size_t first);
+size_t run_left  (extheap_run_t* run);
+
+/**
+ * Create a new external-memory priority queue.
+ * O(1)
+ *
+ * @param[out] out           The out ptr to the new queue
+ * @param[in]  elem_size     The size in bytes of each element
+ * @param[in]  cmp           The comparitor, which receives pointers to elements
+ * @param[in]  memory_budget Bytes of element storage to use, half for the in-memory heap
+ *                           and half for run read buffers
+ * @param[in]  dir           The directory for run files, NULL for tmpfile()
+ * @return                   1 if the queue is created, otherwise 0
+ */
+int extheap_new(extheap_t** out, size_t elem_size, compare_f cmp, size_t memory_budget, const char* dir)
+{
+    assert(out);
+    assert(elem_size > 0);
+    assert(cmp);
+
+    *out = NULL;
+    extheap_t* ext = (extheap_t*)BINARY_HEAP_ALLOC(sizeof(extheap_t));
+    assert(ext);
+    if (!ext)
+        return 0;
+
+    ext->cmp = cmp;
+    ext->elem_size = elem_size;
+    ext->memory_limit = memory_budget / 2 / elem_size;
+    ext->block = memory_budget / 2 / (EXTHEAP_MAX_RUNS + 1) / elem_size;
+    if (ext->memory_limit == 0)
+        ext->memory_limit = 1;
+    if (ext->block == 0)
+        ext->block = 1;
+    ext->memory = NULL;
+    ext->run_count = 0;
+    ext->dir = NULL;
+    ext->run_seq = 0;
+    ext->size = 0;
+
+    /* The in-memory heap is allocated once at its limit and reused */
+    binary_heap_new_sized(&ext->memory, elem_size, cmp);
+    if (ext->memory && !binary_heap_reserve(ext->memory, ext->memory_limit)) {
+        binary_heap_destroy(ext->memory);
+        ext->memory = NULL;
+    }
+    if (dir) {
+        ext->dir = (char*)BINARY_HEAP_ALLOC(strlen(dir) + 1);
+        if (ext->dir)
+            strcpy(ext->dir, dir);
+    }
+
+    if (!ext->memory || (dir && !ext->dir)) {
+        extheap_destroy(ext);
+        return 0;
+    }
+
+    *out = ext;
+    return 1;
+}
+
+/**
+ * Destroy an external-memory priority queue and remove its run files.
+ * O(r)
+ *
+ * @param[in] ext   The queue
+ */
+void extheap_destroy(extheap_t* ext)
+{
+    assert(ext);
+
+    size_t i;
+    for (i = 0; i < ext->run_count; ++i)
+        close_run(ext, &ext->runs[i]);
+
+    if (ext->memory)
+        binary_heap_destroy(ext->memory);
+    BINARY_HEAP_FREE(ext->dir);
+    BINARY_HEAP_FREE(ext);
+}
+
+/**
+ * Get the number of elements, in memory and on disk.
+ * O(1)
+ *
+ * @param[in] ext   The queue
+ * @return          The number of elements
+ */
+size_t extheap_size(extheap_t* ext)
+{
+    assert(ext);
+    return (ext->size);
+}
+
+/**
+ * Get the number of sorted runs on disk.
+ * O(1)
+ *
+ * @param[in] ext   The queue
+ * @return          The number of runs, at most EXTHEAP_MAX_RUNS
+ */
+size_t extheap_runs(extheap_t* ext)
+{
+    assert(ext);
+    return (ext->run_count);
+}
+
+/**
+ * Copy a new element in. Spills the in-memory heap to a run first if it
+ * is full.
+ * O(logn) amortized, plus O(M) of disk writes per spill
+ *
+ * @param[in] ext   The queue
+ * @param[in] elem  Pointer to the elem_size bytes to copy in
+ * @return          1 if the add is successful, otherwise 0 and the queue is unchanged
+ */
+int extheap_push(extheap_t* ext, const void* elem)
+{
+    assert(ext);
+    assert(elem);
+
+    if (binary_heap_size(ext->memory) >= ext->memory_limit && !spill(ext))
+        return 0;
+
+    if (!binary_heap_push_value(ext->memory, elem))
+        return 0;
+
+    ++ext->size;
+    return 1;
+}
+
+/**
+ * Remove the top-most element, copying it out.
+ * O(logn + r)
+ *
+ * @param[in]  ext  The queue
+ * @param[out] out  Room for elem_size bytes to receive the removed element
+ * @return          1 if an element was removed, otherwise 0 if the queue is empty or a
+ *                  run could not be read back, leaving the queue unchanged
+ */
+int extheap_pop(extheap_t* ext, void* out)
+{
+    assert(ext);
+    assert(out);
+
+    size_t from;
+    unsigned char* best;
+    if (!best_head(ext, &from, &best) || !best)
+        return 0;
+
+    if (from == ext->run_count) {
+        binary_heap_pop_value(ext->memory, out);
+    }
+    else {
+        memcpy(out, best, ext->elem_size);
+        advance_run(ext, from);
+    }
+
+    --ext->size;
+    return 1;
+}
+
+/**
+ * Copy out the top-most element without removing it.
+ * O(r)
+ *
+ * @param[in]  ext  The queue
+ * @param[out] out  Room for elem_size bytes to receive the element
+ * @return          1 if the queue is not empty, otherwise 0, also if a run could not be read back
+ */
+int extheap_peek(extheap_t* ext, void* out)
+{
+    assert(ext);
+    assert(out);
+
+    size_t from;
+    unsigned char* best;
+    if (!best_head(ext, &from, &best) || !best)
+        return 0;
+
+    memcpy(out, best, ext->elem_size);
+    return 1;
+}
+
+/**
+ * Create an empty run file, named after the queue in dir if there is one.
+ *
+ * @param[in] ext   The queue
+ * @param[in] run   The run to open
+ * @return          1 if the file is open for writing, otherwise 0
+ */
+int open_run(extheap_t* ext, extheap_run_t* run)
+{
+    memset(run, 0, sizeof(*run));
+    if (!ext->dir) {
+        run->file = tmpfile();
+        return (run->file != NULL);
+    }
+
+    run->path = (char*)BINARY_HEAP_ALLOC(strlen(ext->dir) + 64);
+    if (!run->path)
+        return 0;
+
+    sprintf(run->path, "%s/extheap-%p-%lu.run", ext->dir, (void*)ext, ext->run_seq++);
+    run->file = fopen(run->path, "w+b");
+    if (!run->file) {
+        BINARY_HEAP_FREE(run->path);
+        run->path = NULL;
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Close a run, removing its file.
+ *
+ * @param[in] ext   The queue
+ * @param[in] run   The run to close
+ */
+void close_run(extheap_t* ext, extheap_run_t* run)
+{
+    (void)ext;
+
+    if (run->file)
+        fclose(run->file);
+    if (run->path)
+        remove(run->path);
+
+    BINARY_HEAP_FREE(run->path);
+    BINARY_HEAP_FREE(run->buffer);
+    memset(run, 0, sizeof(*run));
+}
+
+/**
+ * Switch a fully written run over to reading from its start.
+ *
+ * @param[in] ext   The queue
+ * @param[in] run   The run
+ * @param[in] count The number of elements written
+ * @return          1 if the run is ready to read, otherwise 0
+ */
+int start_reading(extheap_t* ext, extheap_run_t* run, size_t count)
+{
+    if (fflush(run->file) != 0 || fseek(run->file, 0, SEEK_SET) != 0)
+        return 0;
+
+    run->buffer = (unsigned char*)BINARY_HEAP_ALLOC(ext->block * ext->elem_size);
+    if (!run->buffer)
+        return 0;
+
+    run->next = 0;
+    run->buffered = 0;
+    run->remaining = count;
+    run->count = count;
+    return 1;
+}
+
+/**
+ * Put a run back to having consumed elements, after a failed merge read
+ * past that point.
+ *
+ * @param[in] ext       The queue
+ * @param[in] run       The run
+ * @param[in] consumed  The number of elements popped from the run
+ */
+void rewind_run(extheap_t* ext, extheap_run_t* run, size_t consumed)
+{
+    run->next = 0;
+    run->buffered = 0;
+    run->remaining = run->count - consumed;
+    fseek(run->file, (long)(consumed * ext->elem_size), SEEK_SET);
+}
+
+/**
+ * Get the next element of a run, reading the next block if the buffer is
+ * used up. A short read is an I/O error, the run is left as it was so the
+ * read can be retried.
+ *
+ * @param[in]  ext   The queue
+ * @param[in]  run   The run
+ * @param[out] head  Pointer to the element in the buffer, NULL if the run is used up
+ * @return           1 on success, otherwise 0 if the next block could not be read
+ */
+int run_head(extheap_t* ext, extheap_run_t* run, unsigned char** head)
+{
+    *head = NULL;
+    if (run->next == run->buffered) {
+        if (run->remaining == 0)
+            return 1;
+
+        size_t count = (run->remaining < ext->block ? run->remaining : ext->block);
+        if (fread(run->buffer, ext->elem_size, count, run->file) != count) {
+            clearerr(run->file);
+            fseek(run->file, (long)((run->count - run->remaining) * ext->elem_size), SEEK_SET);
+            return 0;
+        }
+
+        run->next = 0;
+        run->buffered = count;
+        run->remaining -= count;
+    }
+
+    *head = run->buffer + run->next * ext->elem_size;
+    return 1;
+}
+
+/**
+ * Step past the head of a run, closing it once it is used up.
+ *
+ * @param[in] ext   The queue
+ * @param[in] index The index of the run
+ */
+void advance_run(extheap_t* ext, size_t index)
+{
+    extheap_run_t* run = &ext->runs[index];
+    if (++run->next < run->buffered || run->remaining)
+        return;
+
+    close_run(ext, run);
+    ext->runs[index] = ext->runs[--ext->run_count];
+    memset(&ext->runs[ext->run_count], 0, sizeof(extheap_run_t));
+}
+
+/**
+ * Find the best of the in-memory top and the head of every run.
+ *
+ * @param[in]  ext  The queue
+ * @param[out] from The index of the run holding it, run_count for the in-memory heap
+ * @param[out] best Pointer to the best element, NULL if the queue is empty
+ * @return          1 on success, otherwise 0 if a run could not be read back
+ */
+int best_head(extheap_t* ext, size_t* from, unsigned char** best)
+{
+    void* top = NULL;
+    binary_heap_peek(ext->memory, &top);
+    *best = (unsigned char*)top;
+    *from = ext->run_count;
+
+    size_t i;
+    for (i = 0; i < ext->run_count; ++i) {
+        unsigned char* head;
+        if (!run_head(ext, &ext->runs[i], &head))
+            return 0;
+
+        if (head && (!*best || ext->cmp(head, *best) < 0)) {
+            *best = head;
+            *from = i;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Sort the in-memory heap in place and write it out as a new run, merging
+ * the existing runs into one first if there is no room for another.
+ *
+ * @param[in] ext   The queue
+ * @return          1 if the heap was spilled, otherwise 0 and the queue is unchanged
+ */
+int spill(extheap_t* ext)
+{
+    /* Merge the smaller half of the runs, largest runs first */
+    if (ext->run_count == EXTHEAP_MAX_RUNS) {
+        size_t i, j;
+        for (i = 1; i < ext->run_count; ++i) {
+            extheap_run_t run = ext->runs[i];
+            for (j = i; j > 0 && run_left(&ext->runs[j - 1]) < run_left(&run); --j)
+                ext->runs[j] = ext->runs[j - 1];
+            ext->runs[j] = run;
+        }
+
+        if (!merge_runs(ext, EXTHEAP_MAX_RUNS / 2))
+            return 0;
+    }
+
+    /* Sorted in place, which is still a valid heap if the write fails */
+    size_t count;
+    unsigned char* sorted = (unsigned char*)binary_heap_sort_in_place(ext->memory, &count);
+    if (!sorted)
+        return 0;
+
+    extheap_run_t* run = &ext->runs[ext->run_count];
+    if (!open_run(ext, run))
+        return 0;
+
+    if (fwrite(sorted, ext->elem_size, count, run->file) != count || !start_reading(ext, run, count)) {
+        close_run(ext, run);
+        return 0;
+    }
+
+    ++ext->run_count;
+    binary_heap_clear(ext->memory);
+    return 1;
+}
+
+/**
+ * Get the number of elements left in a run.
+ *
+ * @param[in] run   The run
+ * @return          The number of elements not yet popped
+ */
+size_t run_left(extheap_run_t* run)
+{
+    return (run->remaining + run->buffered - run->next);
+}
+
+/**
+ * Merge the runs from first on into one, reading each in blocks and
+ * writing the merged run a block at a time.
+ *
+ * @param[in] ext   The queue
+ * @param[in] first The index of the first run to merge
+ * @return          1 if the runs were merged, otherwise 0 and the runs are unchanged
+ */
+int merge_runs(extheap_t* ext, size_t first)
+{
+    extheap_run_t merged;
+    size_t consumed[EXTHEAP_MAX_RUNS];
+    size_t total = 0;
+
+    size_t i;
+    for (i = first; i < ext->run_count; ++i) {
+        consumed[i] = ext->runs[i].count - run_left(&ext->runs[i]);
+        total += run_left(&ext->runs[i]);
+    }
+
+    unsigned char* block = (unsigned char*)BINARY_HEAP_ALLOC(ext->block * ext->elem_size);
+    if (!block)
+        return 0;
+    if (!open_run(ext, &merged)) {
+        BINARY_HEAP_FREE(block);
+        return 0;
+    }
+
+    int success = 1;
+    size_t written = 0;
+    while (success && written < total) {
+        size_t count = 0;
+        while (count < ext->block && written + count < total) {
+            unsigned char* best = NULL;
+            size_t from = first;
+            for (i = first; i < ext->run_count && success; ++i) {
+                unsigned char* head;
+                success = run_head(ext, &ext->runs[i], &head);
+                if (success && head && (!best || ext->cmp(head, best) < 0)) {
+                    best = head;
+                    from = i;
+                }
+            }
+            if (!success)
+                break;
+
+            memcpy(block + count * ext->elem_size, best, ext->elem_size);
+            ++ext->runs[from].next;
+            ++count;
+        }
+
+        if (success)
+            success = (fwrite(block, ext->elem_size, count, merged.file) == count);
+        written += count;
+    }
+
+    BINARY_HEAP_FREE(block);
+    if (!success || !start_reading(ext, &merged, total)) {
+        close_run(ext, &merged);
+        for (i = first; i < ext->run_count; ++i)
+            rewind_run(ext, &ext->runs[i], consumed[i]);
+        return 0;
+    }
+
+    for (i = first; i < ext->run_count; ++i)
+        close_run(ext, &ext->runs[i]);
+    ext->runs[first] = merged;
+    ext->run_count = first + 1;
+    return 1;
+}
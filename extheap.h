@@ -0,0 +1,65 @@
+/*
+ * extheap.h
+ * Copyright (C) 2016-2017 Chad Mowery
+ *
+ * 
+ * extheap.h is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * extheap.h is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef EXTHEAP_H
+#define EXTHEAP_H
+
+#include "binaryheap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * External-memory priority queue for more fixed size elements than fit in
+ * memory. Pushes go to an in-memory sized binary_heap_t. When it fills
+ * half the memory budget it is sorted in place and written out as a run,
+ * a sorted file read back sequentially in blocks. Pops take the best of
+ * the in-memory top and the head of every run. Once there are
+ * EXTHEAP_MAX_RUNS runs the smaller half are merged into one, so each
+ * element is written O(log(n / M) / log(EXTHEAP_MAX_RUNS / 2)) times for a
+ * budget of M, and disk traffic is always large sequential reads and
+ * writes.
+ *
+ * Elements are copied to disk as raw bytes, so they must not hold
+ * pointers. Run files go in the given directory, or are anonymous
+ * tmpfile()s when it is NULL, and are removed when no longer needed.
+ */
+
+/* Runs kept before they are merged into one */
+#ifndef EXTHEAP_MAX_RUNS
+#define EXTHEAP_MAX_RUNS 16
+#endif
+
+/* Forward declare */
+typedef struct extheap extheap_t;
+
+
+int 	extheap_new    (extheap_t** out, size_t elem_size, compare_f cmp, size_t memory_budget, const char* dir);
+void 	extheap_destroy(extheap_t* ext);
+size_t	extheap_size   (extheap_t* ext);
+size_t	extheap_runs   (extheap_t* ext);
+int 	extheap_push   (extheap_t* ext, const void* elem);
+int 	extheap_pop    (extheap_t* ext, void* out);
+int 	extheap_peek   (extheap_t* ext, void* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EXTHEAP_H */
@@ -0,0 +1,213 @@
+/*
+ * heapalloc.c
+ * Copyright (C) 2016-2017 Chad Mowery
+ *
+ * 
+ * heapalloc.c is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * heapalloc.c is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "heapalloc.h"
+
+/* Uncomment to disable asserts
+ * #define NDEBUG */
+#include <assert.h>
+
+#include <string.h>
+
+/* Forware declarations */
+void* arena_alloc  (void* ctx, size_t size);
+void* arena_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size);
+void  arena_free   (void* ctx, void* ptr, size_t size);
+void* pool_alloc   (void* ctx, size_t size);
+void* pool_realloc (void* ctx, void* ptr, size_t old_size, size_t new_size);
+void  pool_free    (void* ctx, void* ptr, size_t size);
+
+#define ALIGN_UP(x) (((x) + (HEAP_ALLOC_ALIGN - 1)) & ~(size_t)(HEAP_ALLOC_ALIGN - 1))
+
+const binary_heap_allocator_t binary_heap_arena_allocator = { &arena_alloc, &arena_realloc, &arena_free };
+const binary_heap_allocator_t binary_heap_pool_allocator = { &pool_alloc, &pool_realloc, &pool_free };
+
+
+/**
+ * Set up an arena over a caller owned buffer.
+ *
+ * @param[in] arena     The arena
+ * @param[in] buffer    The memory to allocate from
+ * @param[in] size      The size of the buffer in bytes
+ */
+void binary_heap_arena_init(binary_heap_arena_t* arena, void* buffer, size_t size)
+{
+    assert(arena);
+    assert(buffer || size == 0);
+
+    /* Start on an aligned address */
+    size_t skip = ALIGN_UP((uintptr_t)buffer) - (uintptr_t)buffer;
+    if (skip > size)
+        skip = size;
+
+    arena->base = (unsigned char*)buffer + skip;
+    arena->size = size - skip;
+    arena->used = 0;
+}
+
+/**
+ * Free every allocation made from an arena. Heaps allocated from it must
+ * no longer be used, there is no need to destroy them first.
+ * O(1)
+ *
+ * @param[in] arena The arena
+ */
+void binary_heap_arena_reset(binary_heap_arena_t* arena)
+{
+    assert(arena);
+    arena->used = 0;
+}
+
+/**
+ * Get the number of bytes allocated from an arena.
+ * O(1)
+ *
+ * @param[in] arena The arena
+ * @return          The number of bytes in use, including alignment padding
+ */
+size_t binary_heap_arena_used(binary_heap_arena_t* arena)
+{
+    assert(arena);
+    return (arena->used);
+}
+
+void* arena_alloc(void* ctx, size_t size)
+{
+    binary_heap_arena_t* arena = (binary_heap_arena_t*)ctx;
+
+    size_t rounded = ALIGN_UP(size);
+    if (rounded < size || rounded > arena->size - arena->used)
+        return NULL;
+
+    void* ptr = arena->base + arena->used;
+    arena->used += rounded;
+    return (ptr);
+}
+
+void* arena_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size)
+{
+    binary_heap_arena_t* arena = (binary_heap_arena_t*)ctx;
+    size_t old_rounded = ALIGN_UP(old_size);
+
+    /* The most recent allocation grows in place */
+    if ((unsigned char*)ptr + old_rounded == arena->base + arena->used) {
+        size_t start = arena->used - old_rounded;
+        size_t rounded = ALIGN_UP(new_size);
+        if (rounded < new_size || rounded > arena->size - start)
+            return NULL;
+
+        arena->used = start + rounded;
+        return (ptr);
+    }
+
+    void* moved = arena_alloc(ctx, new_size);
+    if (moved)
+        memcpy(moved, ptr, old_size < new_size ? old_size : new_size);
+
+    return (moved);
+}
+
+void arena_free(void* ctx, void* ptr, size_t size)
+{
+    binary_heap_arena_t* arena = (binary_heap_arena_t*)ctx;
+
+    /* Only the most recent allocation can be given back */
+    size_t rounded = ALIGN_UP(size);
+    if ((unsigned char*)ptr + rounded == arena->base + arena->used)
+        arena->used -= rounded;
+}
+
+/**
+ * Set up a pool of fixed-size blocks over a caller owned buffer.
+ * O(n)
+ *
+ * @param[in] pool          The pool
+ * @param[in] buffer        The memory to split into blocks
+ * @param[in] size          The size of the buffer in bytes
+ * @param[in] block_size    The size of each block, rounded up to HEAP_ALLOC_ALIGN
+ * @return                  The number of blocks in the pool
+ */
+size_t binary_heap_pool_init(binary_heap_pool_t* pool, void* buffer, size_t size, size_t block_size)
+{
+    assert(pool);
+    assert(buffer || size == 0);
+    assert(block_size > 0);
+
+    size_t skip = ALIGN_UP((uintptr_t)buffer) - (uintptr_t)buffer;
+    unsigned char* base = (unsigned char*)buffer + skip;
+
+    pool->block_size = ALIGN_UP(block_size);
+    pool->blocks = (skip < size ? (size - skip) / pool->block_size : 0);
+    pool->available = pool->blocks;
+    pool->free_list = NULL;
+
+    /* Thread the free list through the blocks, first block on top */
+    size_t i = pool->blocks;
+    while (i-- > 0) {
+        void* block = base + i * pool->block_size;
+        *(void**)block = pool->free_list;
+        pool->free_list = block;
+    }
+
+    return (pool->blocks);
+}
+
+/**
+ * Get the number of free blocks in a pool.
+ * O(1)
+ *
+ * @param[in] pool  The pool
+ * @return          The number of free blocks
+ */
+size_t binary_heap_pool_available(binary_heap_pool_t* pool)
+{
+    assert(pool);
+    return (pool->available);
+}
+
+void* pool_alloc(void* ctx, size_t size)
+{
+    binary_heap_pool_t* pool = (binary_heap_pool_t*)ctx;
+
+    if (size > pool->block_size || !pool->free_list)
+        return NULL;
+
+    void* block = pool->free_list;
+    pool->free_list = *(void**)block;
+    --pool->available;
+    return (block);
+}
+
+void* pool_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size)
+{
+    binary_heap_pool_t* pool = (binary_heap_pool_t*)ctx;
+    (void)old_size;
+
+    /* Blocks never move, so growing only works within the block */
+    return (new_size <= pool->block_size ? ptr : NULL);
+}
+
+void pool_free(void* ctx, void* ptr, size_t size)
+{
+    binary_heap_pool_t* pool = (binary_heap_pool_t*)ctx;
+    (void)size;
+
+    *(void**)ptr = pool->free_list;
+    pool->free_list = ptr;
+    ++pool->available;
+}
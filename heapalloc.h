@@ -0,0 +1,78 @@
+/*
+ * heapalloc.h
+ * Copyright (C) 2016-2017 Chad Mowery
+ *
+ * 
+ * heapalloc.h is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * heapalloc.h is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef HEAP_ALLOC_H
+#define HEAP_ALLOC_H
+
+#include "binaryheap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Allocators for binary_heap_new_with_allocator, both carving memory out of
+ * a caller provided buffer so short-lived heaps never touch malloc. Neither
+ * is thread safe, use one per thread.
+ */
+
+/* Alignment of every allocation */
+#define HEAP_ALLOC_ALIGN 16
+
+/*
+ * Arena (bump) allocator. Allocations are carved off the front of the
+ * buffer. Freeing or growing the most recent allocation works in place,
+ * anything else is only reclaimed by binary_heap_arena_reset, which frees
+ * every allocation at once, e.g. at the end of a request.
+ */
+typedef struct binary_heap_arena {
+    unsigned char* base;
+    size_t size;
+    size_t used;
+} binary_heap_arena_t;
+
+extern const binary_heap_allocator_t binary_heap_arena_allocator;
+
+void 	binary_heap_arena_init (binary_heap_arena_t* arena, void* buffer, size_t size);
+void 	binary_heap_arena_reset(binary_heap_arena_t* arena);
+size_t	binary_heap_arena_used (binary_heap_arena_t* arena);
+
+/*
+ * Fixed-size pool allocator. The buffer is split into equal blocks kept on
+ * a free list, so allocating and freeing are O(1) and memory is reused as
+ * heaps come and go. Allocations larger than a block fail, so size blocks
+ * for the largest heap storage needed: a pointer heap with capacity c needs
+ * c * sizeof(void*) + 64 bytes, and the heap object takes one more block.
+ */
+typedef struct binary_heap_pool {
+    void*  free_list;
+    size_t block_size;
+    size_t blocks;
+    size_t available;
+} binary_heap_pool_t;
+
+extern const binary_heap_allocator_t binary_heap_pool_allocator;
+
+size_t	binary_heap_pool_init     (binary_heap_pool_t* pool, void* buffer, size_t size, size_t block_size);
+size_t	binary_heap_pool_available(binary_heap_pool_t* pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEAP_ALLOC_H */
@@ -0,0 +1,354 @@
+/*
+ * kmerge.c
+ * Copyright (C) 2016-2017 Chad Mowery
+ *
+ * 
+ * kmerge.c is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kmerge.c is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "kmerge.h"
+
+/* Uncomment to disable asserts
+ * #define NDEBUG */
+#include <assert.h>
+
+#include <string.h>
+
+struct kmerge {
+    compare_f     cmp;
+    kmerge_next_f next;
+    void**        sources;
+    size_t        k;
+    size_t        elem_size;
+    int           mode;
+
+    /* KMERGE_HEAP, each head is followed by its source index */
+    binary_heap_t* heap;
+    unsigned char* slot;
+    size_t         index_offset;
+
+    /* KMERGE_LOSER_TREE, tree[0] is the overall winner and tree[1..k) the
+     * source that lost the match at each node. Source i is leaf k + i. */
+    size_t*        tree;
+    unsigned char* heads;
+    unsigned char* alive;
+    size_t         comparisons;
+};
+
+/* Forware declarations */
+int    kmerge_prime_heap (kmerge_t* merge);
+int    kmerge_prime_tree (kmerge_t* merge);
+size_t kmerge_read_heap  (kmerge_t* merge, unsigned char* out, size_t count);
+size_t kmerge_read_tree  (kmerge_t* merge, unsigned char* out, size_t count);
+int    loser_beats       (kmerge_t* merge, size_t a, size_t b);
+void   loser_replay      (kmerge_t* merge, size_t winner);
+
+#define KMERGE_HEAD(m, i) ((m)->heads + (i) * (m)->elem_size)
+
+/**
+ * Create a k-way merge and read the first element of every source.
+ * O(k logk)
+ *
+ * @param[out] out       The out ptr to the new merge
+ * @param[in]  elem_size The size in bytes of each element
+ * @param[in]  cmp       The comparitor, which receives pointers to elements
+ * @param[in]  next      The callback reading the next element of a source
+ * @param[in]  sources   The k sources, the array is copied
+ * @param[in]  k         The number of sources
+ * @param[in]  mode      KMERGE_HEAP or KMERGE_LOSER_TREE
+ * @return               1 if the merge is created, otherwise 0
+ */
+int kmerge_new(kmerge_t** out, size_t elem_size, compare_f cmp, kmerge_next_f next,
+               void** sources, size_t k, int mode)
+{
+    assert(out);
+    assert(elem_size > 0);
+    assert(cmp);
+    assert(next);
+    assert(sources || k == 0);
+    assert(mode == KMERGE_HEAP || mode == KMERGE_LOSER_TREE);
+
+    *out = NULL;
+    kmerge_t* merge = (kmerge_t*)BINARY_HEAP_ALLOC(sizeof(kmerge_t));
+    assert(merge);
+    if (!merge)
+        return 0;
+
+    memset(merge, 0, sizeof(kmerge_t));
+    merge->cmp = cmp;
+    merge->next = next;
+    merge->k = k;
+    merge->elem_size = elem_size;
+    merge->mode = mode;
+
+    /* One extra so an empty merge still allocates */
+    merge->sources = (void**)BINARY_HEAP_ALLOC((k + 1) * sizeof(void*));
+    if (!merge->sources) {
+        kmerge_destroy(merge);
+        return 0;
+    }
+    if (k)
+        memcpy(merge->sources, sources, k * sizeof(void*));
+
+    if (!(mode == KMERGE_HEAP ? kmerge_prime_heap(merge) : kmerge_prime_tree(merge))) {
+        kmerge_destroy(merge);
+        return 0;
+    }
+
+    *out = merge;
+    return 1;
+}
+
+/**
+ * Destroy a k-way merge. The sources are left alone.
+ * O(1)
+ *
+ * @param[in] merge The merge
+ */
+void kmerge_destroy(kmerge_t* merge)
+{
+    assert(merge);
+
+    if (merge->heap)
+        binary_heap_destroy(merge->heap);
+    BINARY_HEAP_FREE(merge->slot);
+    BINARY_HEAP_FREE(merge->tree);
+    BINARY_HEAP_FREE(merge->heads);
+    BINARY_HEAP_FREE(merge->alive);
+    BINARY_HEAP_FREE(merge->sources);
+    BINARY_HEAP_FREE(merge);
+}
+
+/**
+ * Copy up to count of the next merged elements into out.
+ * O(count logk)
+ *
+ * @param[in]  merge The merge
+ * @param[out] out   Room for count elements
+ * @param[in]  count The most elements to read
+ * @return           The number of elements read, less than count only once every source is exhausted
+ */
+size_t kmerge_read(kmerge_t* merge, void* out, size_t count)
+{
+    assert(merge);
+    assert(out || count == 0);
+
+    if (merge->mode == KMERGE_HEAP)
+        return (kmerge_read_heap(merge, (unsigned char*)out, count));
+    return (kmerge_read_tree(merge, (unsigned char*)out, count));
+}
+
+/**
+ * Get the number of comparitor calls made since the merge was created.
+ * KMERGE_HEAP merges report their heap's count, which is 0 unless built
+ * with BINARY_HEAP_COUNT_COMPARISONS.
+ * O(1)
+ *
+ * @param[in] merge The merge
+ * @return          The number of comparisons
+ */
+size_t kmerge_comparisons(kmerge_t* merge)
+{
+    assert(merge);
+
+    if (merge->mode == KMERGE_HEAP)
+        return (binary_heap_comparisons(merge->heap));
+    return (merge->comparisons);
+}
+
+/**
+ * Push the first element of every source onto a sized heap, tagged with
+ * its source index so the top knows where to refill from.
+ *
+ * @param[in] merge The merge
+ * @return          1 on success, otherwise 0
+ */
+int kmerge_prime_heap(kmerge_t* merge)
+{
+    size_t i;
+
+    merge->index_offset = (merge->elem_size + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t);
+    merge->slot = (unsigned char*)BINARY_HEAP_ALLOC(merge->index_offset + sizeof(size_t));
+    if (!merge->slot)
+        return 0;
+
+    binary_heap_new_sized(&merge->heap, merge->index_offset + sizeof(size_t), merge->cmp);
+    if (!merge->heap)
+        return 0;
+
+    for (i = 0; i < merge->k; ++i) {
+        if (!merge->next(merge->sources[i], merge->slot))
+            continue;
+
+        memcpy(merge->slot + merge->index_offset, &i, sizeof(size_t));
+        if (!binary_heap_push_value(merge->heap, merge->slot))
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Read the first element of every source and play the initial tournament
+ * bottom up, storing each match's loser and passing its winner on.
+ *
+ * @param[in] merge The merge
+ * @return          1 on success, otherwise 0
+ */
+int kmerge_prime_tree(kmerge_t* merge)
+{
+    size_t k = merge->k;
+    size_t i;
+
+    merge->tree = (size_t*)BINARY_HEAP_ALLOC((k + 1) * sizeof(size_t));
+    merge->heads = (unsigned char*)BINARY_HEAP_ALLOC((k + 1) * merge->elem_size);
+    merge->alive = (unsigned char*)BINARY_HEAP_ALLOC(k + 1);
+    size_t* winners = (size_t*)BINARY_HEAP_ALLOC((k + 1) * sizeof(size_t));
+    if (!merge->tree || !merge->heads || !merge->alive || !winners) {
+        BINARY_HEAP_FREE(winners);
+        return 0;
+    }
+
+    for (i = 0; i < k; ++i)
+        merge->alive[i] = (unsigned char)(merge->next(merge->sources[i], KMERGE_HEAD(merge, i)) != 0);
+
+    merge->tree[0] = 0;
+    /* Internal nodes from the bottom up, leaves are nodes k and up */
+    for (i = k; i > 1; --i) {
+        size_t node = i - 1;
+        size_t a = (2 * node >= k ? 2 * node - k : winners[2 * node]);
+        size_t b = (2 * node + 1 >= k ? 2 * node + 1 - k : winners[2 * node + 1]);
+
+        if (loser_beats(merge, b, a)) {
+            winners[node] = b;
+            merge->tree[node] = a;
+        }
+        else {
+            winners[node] = a;
+            merge->tree[node] = b;
+        }
+    }
+    if (k > 1)
+        merge->tree[0] = winners[1];
+
+    BINARY_HEAP_FREE(winners);
+    return 1;
+}
+
+/**
+ * Copy out the top and refill it from the same source with a single sift,
+ * or pop it once that source is exhausted.
+ *
+ * @param[in]  merge The merge
+ * @param[out] out   Room for count elements
+ * @param[in]  count The most elements to read
+ * @return           The number of elements read
+ */
+size_t kmerge_read_heap(kmerge_t* merge, unsigned char* out, size_t count)
+{
+    size_t n;
+
+    for (n = 0; n < count; ++n, out += merge->elem_size) {
+        void* top;
+        size_t from;
+
+        binary_heap_peek(merge->heap, &top);
+        if (!top)
+            break;
+
+        memcpy(out, top, merge->elem_size);
+        memcpy(&from, (unsigned char*)top + merge->index_offset, sizeof(size_t));
+
+        if (merge->next(merge->sources[from], merge->slot)) {
+            memcpy(merge->slot + merge->index_offset, &from, sizeof(size_t));
+            binary_heap_replace_value(merge->heap, merge->slot, NULL);
+        }
+        else {
+            binary_heap_pop_value(merge->heap, merge->slot);
+        }
+    }
+
+    return n;
+}
+
+/**
+ * Copy out the overall winner, refill its leaf from its source and replay
+ * its path to the root.
+ *
+ * @param[in]  merge The merge
+ * @param[out] out   Room for count elements
+ * @param[in]  count The most elements to read
+ * @return           The number of elements read
+ */
+size_t kmerge_read_tree(kmerge_t* merge, unsigned char* out, size_t count)
+{
+    size_t n;
+
+    if (merge->k == 0)
+        return 0;
+
+    for (n = 0; n < count; ++n, out += merge->elem_size) {
+        size_t winner = merge->tree[0];
+        if (!merge->alive[winner])
+            break;
+
+        memcpy(out, KMERGE_HEAD(merge, winner), merge->elem_size);
+        merge->alive[winner] = (unsigned char)(merge->next(merge->sources[winner], KMERGE_HEAD(merge, winner)) != 0);
+        loser_replay(merge, winner);
+    }
+
+    return n;
+}
+
+/**
+ * Whether the head of source a comes out before the head of source b.
+ * Exhausted sources lose to everything without calling the comparitor.
+ *
+ * @param[in] merge The merge
+ * @param[in] a     The first source index
+ * @param[in] b     The second source index
+ * @return          1 if a wins, otherwise 0
+ */
+int loser_beats(kmerge_t* merge, size_t a, size_t b)
+{
+    if (!merge->alive[b])
+        return (merge->alive[a]);
+    if (!merge->alive[a])
+        return 0;
+
+    ++merge->comparisons;
+    return (merge->cmp(KMERGE_HEAD(merge, a), KMERGE_HEAD(merge, b)) < 0);
+}
+
+/**
+ * Replay the matches from a refilled leaf up to the root. At each node
+ * the stored loser plays the current winner, one comparison per level.
+ *
+ * @param[in] merge  The merge
+ * @param[in] winner The source whose head changed
+ */
+void loser_replay(kmerge_t* merge, size_t winner)
+{
+    size_t node;
+
+    for (node = (winner + merge->k) / 2; node >= 1; node /= 2) {
+        size_t loser = merge->tree[node];
+
+        if (loser_beats(merge, loser, winner)) {
+            merge->tree[node] = winner;
+            winner = loser;
+        }
+    }
+
+    merge->tree[0] = winner;
+}
@@ -0,0 +1,66 @@
+/*
+ * kmerge.h
+ * Copyright (C) 2016-2017 Chad Mowery
+ *
+ * 
+ * kmerge.h is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * kmerge.h is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef KMERGE_H
+#define KMERGE_H
+
+#include "binaryheap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * K-way merge of sorted sources of fixed size elements, pulled into a
+ * caller buffer in batches. Each source is an opaque pointer handed to
+ * the next callback, which copies its next element into out and returns 1,
+ * or returns 0 once the source is exhausted. Sources must already be
+ * sorted by the comparitor, cmp(a, b) < 0 meaning a comes out first.
+ *
+ * KMERGE_HEAP keeps the head of every source in a sized binary_heap_t and
+ * refills the top from its source with binary_heap_replace_value, a single
+ * sift per element instead of a pop and a push. KMERGE_LOSER_TREE keeps
+ * the heads in a tournament tree of the last match each node lost, so
+ * replaying the winner's path takes at most ceil(log2(k)) comparisons,
+ * exactly log2(k) when k is a power of two.
+ *
+ * Exhausted sources are never compared, and equal elements come out in
+ * no particular source order.
+ */
+
+#define KMERGE_HEAP       0
+#define KMERGE_LOSER_TREE 1
+
+/* Copy the next element of source into out, 1 if there was one, otherwise 0 */
+typedef int (*kmerge_next_f)(void* source, void* out);
+
+/* Forward declare */
+typedef struct kmerge kmerge_t;
+
+
+int 	kmerge_new        (kmerge_t** out, size_t elem_size, compare_f cmp, kmerge_next_f next,
+                           void** sources, size_t k, int mode);
+void 	kmerge_destroy    (kmerge_t* merge);
+size_t	kmerge_read       (kmerge_t* merge, void* out, size_t count);
+size_t	kmerge_comparisons(kmerge_t* merge);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KMERGE_H */
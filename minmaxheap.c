@@ -0,0 +1,397 @@
+/*
+ * minmaxheap.c
+ * Copyright (C) 2016-2017 Chad Mowery
+ *
+ * 
+ * minmaxheap.c is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * minmaxheap.c is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "minmaxheap.h"
+
+/* Uncomment to disable asserts
+ * #define NDEBUG */
+#include <assert.h>
+
+/* Forware declarations */
+int  minmax_grow   (minmax_heap_t* heap);
+int  minmax_before (minmax_heap_t* heap, void* a, void* b, int max);
+int  on_max_level  (size_t index);
+void minmax_up     (minmax_heap_t* heap, size_t index, void* data, int max);
+void minmax_down   (minmax_heap_t* heap, size_t index, void* data, int max);
+void minmax_remove (minmax_heap_t* heap, size_t index, void** out);
+size_t max_index   (minmax_heap_t* heap);
+
+/* Index math for a binary heap */
+#define MINMAX_PARENT(i)      (((i) - 1) / 2)
+#define MINMAX_FIRST_CHILD(i) ((i) * 2 + 1)
+
+struct minmax_heap {
+    compare_f cmp;
+
+    void** data;
+    size_t size;
+    size_t capacity;
+
+    /* Number of comparitor calls made so far */
+    size_t comparisons;
+};
+
+/**
+ * Create a new, empty min-max heap.
+ * O(1)
+ *
+ * @param[out] out  The out ptr to the new min-max heap
+ * @param[in]  cmp  The comparitor function pointer
+ * @return          1 if the heap is created, otherwise 0
+ */
+int minmax_heap_new(minmax_heap_t** out, compare_f cmp)
+{
+    assert(out);
+    assert(cmp);
+
+    *out = NULL;
+    minmax_heap_t* heap = (minmax_heap_t*)BINARY_HEAP_ALLOC(sizeof(minmax_heap_t));
+    assert(heap);
+    if (!heap)
+        return 0;
+
+    heap->cmp = cmp;
+    heap->data = NULL;
+    heap->size = 0;
+    heap->capacity = 0;
+    heap->comparisons = 0;
+
+    *out = heap;
+    return 1;
+}
+
+/**
+ * Destroy a min-max heap, without freeing elements.
+ * O(1)
+ *
+ * @param[in] heap  The min-max heap
+ */
+void minmax_heap_destroy(minmax_heap_t* heap)
+{
+    assert(heap);
+
+    BINARY_HEAP_FREE(heap->data);
+    BINARY_HEAP_FREE(heap);
+}
+
+/**
+ * Get the number of elements.
+ * O(1)
+ *
+ * @param[in] heap  The min-max heap
+ * @return          The number of elements
+ */
+size_t minmax_heap_size(minmax_heap_t* heap)
+{
+    assert(heap);
+    return (heap->size);
+}
+
+/**
+ * Get the number of comparitor calls made since the heap was created.
+ * O(1)
+ *
+ * @param[in] heap  The min-max heap
+ * @return          The number of comparisons
+ */
+size_t minmax_heap_comparisons(minmax_heap_t* heap)
+{
+    assert(heap);
+    return (heap->comparisons);
+}
+
+/**
+ * Add a new data element. It starts as a leaf and bubbles up through
+ * either the min or the max levels, depending on how it compares with
+ * its parent.
+ * O(logn)
+ *
+ * @param[in] heap  The min-max heap
+ * @param[in] data  The data element to add
+ * @return          1 if the add is successful, otherwise 0
+ */
+int minmax_heap_push(minmax_heap_t* heap, void* data)
+{
+    assert(heap);
+
+    if (heap->size == heap->capacity && !minmax_grow(heap))
+        return 0;
+
+    size_t index = heap->size++;
+    if (index == 0) {
+        heap->data[0] = data;
+        return 1;
+    }
+
+    /* An element on the wrong side of its parent swaps with it, then
+     * only has to climb the parent's kind of levels */
+    size_t parent = MINMAX_PARENT(index);
+    int max = on_max_level(index);
+    if (minmax_before(heap, data, heap->data[parent], !max)) {
+        heap->data[index] = heap->data[parent];
+        minmax_up(heap, parent, data, !max);
+    }
+    else {
+        minmax_up(heap, index, data, max);
+    }
+
+    return 1;
+}
+
+/**
+ * Peek at the min element.
+ * O(1)
+ *
+ * @param[in]  heap The min-max heap
+ * @param[out] out  The out ptr to the min element
+ * @return          1 if the heap is not empty, otherwise 0
+ */
+int minmax_heap_peek_min(minmax_heap_t* heap, void** out)
+{
+    assert(heap);
+    assert(out);
+
+    if (heap->size == 0)
+        return 0;
+
+    *out = heap->data[0];
+    return 1;
+}
+
+/**
+ * Peek at the max element.
+ * O(1)
+ *
+ * @param[in]  heap The min-max heap
+ * @param[out] out  The out ptr to the max element
+ * @return          1 if the heap is not empty, otherwise 0
+ */
+int minmax_heap_peek_max(minmax_heap_t* heap, void** out)
+{
+    assert(heap);
+    assert(out);
+
+    if (heap->size == 0)
+        return 0;
+
+    *out = heap->data[max_index(heap)];
+    return 1;
+}
+
+/**
+ * Remove the min element.
+ * O(logn)
+ *
+ * @param[in]  heap The min-max heap
+ * @param[out] out  The out ptr to the removed element
+ * @return          1 if an element was removed, otherwise 0
+ */
+int minmax_heap_pop_min(minmax_heap_t* heap, void** out)
+{
+    assert(heap);
+    assert(out);
+
+    if (heap->size == 0)
+        return 0;
+
+    minmax_remove(heap, 0, out);
+    return 1;
+}
+
+/**
+ * Remove the max element.
+ * O(logn)
+ *
+ * @param[in]  heap The min-max heap
+ * @param[out] out  The out ptr to the removed element
+ * @return          1 if an element was removed, otherwise 0
+ */
+int minmax_heap_pop_max(minmax_heap_t* heap, void** out)
+{
+    assert(heap);
+    assert(out);
+
+    if (heap->size == 0)
+        return 0;
+
+    minmax_remove(heap, max_index(heap), out);
+    return 1;
+}
+
+/**
+ * Grow storage by doubling, starting from BINARY_HEAP_INITIAL_CAPACITY.
+ *
+ * @param[in] heap  The min-max heap
+ * @return          1 if the heap has room for another element, otherwise 0
+ */
+int minmax_grow(minmax_heap_t* heap)
+{
+    if (heap->capacity && !BINARY_HEAP_RESIZE)
+        return 0;
+
+    /* Stop doubling before the size in bytes overflows */
+    if (heap->capacity > (size_t)-1 / 2 / sizeof(void*))
+        return 0;
+
+    size_t capacity = (heap->capacity ? heap->capacity * 2 : BINARY_HEAP_INITIAL_CAPACITY);
+    void** data = (void**)BINARY_HEAP_REALLOC(heap->data, capacity * sizeof(void*));
+    assert(data);
+    if (!data)
+        return 0;
+
+    heap->data = data;
+    heap->capacity = capacity;
+    return 1;
+}
+
+/**
+ * Check whether a belongs closer to one end of the heap than b.
+ *
+ * @param[in] heap  The min-max heap
+ * @param[in] a     The first data element
+ * @param[in] b     The second data element
+ * @param[in] max   1 to check for the max end, 0 for the min end
+ * @return          1 if a is strictly before b from that end, otherwise 0
+ */
+int minmax_before(minmax_heap_t* heap, void* a, void* b, int max)
+{
+    ++heap->comparisons;
+
+    int result = heap->cmp(a, b);
+    return (max ? result > 0 : result < 0);
+}
+
+/**
+ * Check whether an index is on a max level, the odd levels of the tree.
+ *
+ * @param[in] index The heap index
+ * @return          1 for a max level, 0 for a min level
+ */
+int on_max_level(size_t index)
+{
+    int level = 0;
+    for (++index; index > 1; index >>= 1)
+        ++level;
+
+    return (level & 1);
+}
+
+/**
+ * Find the index of the max element of a non-empty heap.
+ *
+ * @param[in] heap  The min-max heap
+ * @return          0 for a single element, otherwise 1 or 2
+ */
+size_t max_index(minmax_heap_t* heap)
+{
+    if (heap->size <= 2)
+        return (heap->size - 1);
+
+    return (minmax_before(heap, heap->data[2], heap->data[1], 1) ? 2 : 1);
+}
+
+/**
+ * Place data into the hole at index, moving it up through grandparents
+ * on the same kind of level while it belongs before them.
+ *
+ * @param[in] heap  The min-max heap
+ * @param[in] index The heap index of the hole
+ * @param[in] data  The data element to place
+ * @param[in] max   1 if index is on a max level, 0 for a min level
+ */
+void minmax_up(minmax_heap_t* heap, size_t index, void* data, int max)
+{
+    while (index > 2) {
+        size_t grandparent = MINMAX_PARENT(MINMAX_PARENT(index));
+        if (!minmax_before(heap, data, heap->data[grandparent], max))
+            break;
+
+        heap->data[index] = heap->data[grandparent];
+        index = grandparent;
+    }
+
+    heap->data[index] = data;
+}
+
+/**
+ * Place data into the hole at index, moving the hole down through the
+ * same kind of levels. Each step picks the best of up to 2 children and
+ * 4 grandchildren. When the hole reaches a grandchild, data may be on the
+ * wrong side of the grandchild's parent, and swaps with it.
+ *
+ * @param[in] heap  The min-max heap
+ * @param[in] index The heap index of the hole
+ * @param[in] data  The data element to place
+ * @param[in] max   1 if index is on a max level, 0 for a min level
+ */
+void minmax_down(minmax_heap_t* heap, size_t index, void* data, int max)
+{
+    for (;;) {
+        size_t child = MINMAX_FIRST_CHILD(index);
+        if (child >= heap->size)
+            break;
+
+        /* Best of the children, then of the grandchildren */
+        size_t best = child;
+        if (child + 1 < heap->size && minmax_before(heap, heap->data[child + 1], heap->data[best], max))
+            best = child + 1;
+
+        size_t grandchild = MINMAX_FIRST_CHILD(child);
+        size_t last = grandchild + 4;
+        if (last > heap->size)
+            last = heap->size;
+        for (; grandchild < last; ++grandchild) {
+            if (minmax_before(heap, heap->data[grandchild], heap->data[best], max))
+                best = grandchild;
+        }
+
+        if (!minmax_before(heap, heap->data[best], data, max))
+            break;
+
+        heap->data[index] = heap->data[best];
+        index = best;
+        if (best <= child + 1)
+            break;
+
+        size_t parent = MINMAX_PARENT(best);
+        if (minmax_before(heap, data, heap->data[parent], !max)) {
+            void* swap = heap->data[parent];
+            heap->data[parent] = data;
+            data = swap;
+        }
+    }
+
+    heap->data[index] = data;
+}
+
+/**
+ * Remove the element at index, which must be the min or the max, by
+ * moving the last element into its place.
+ *
+ * @param[in]  heap     The min-max heap
+ * @param[in]  index    The heap index of the element to remove
+ * @param[out] out      The out ptr to the removed element
+ */
+void minmax_remove(minmax_heap_t* heap, size_t index, void** out)
+{
+    *out = heap->data[index];
+
+    void* last = heap->data[--heap->size];
+    if (index < heap->size)
+        minmax_down(heap, index, last, on_max_level(index));
+}
@@ -0,0 +1,58 @@
+/*
+ * minmaxheap.h
+ * Copyright (C) 2016-2017 Chad Mowery
+ *
+ * 
+ * minmaxheap.h is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * minmaxheap.h is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MINMAX_HEAP_H
+#define MINMAX_HEAP_H
+
+#include "binaryheap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Double-ended priority queue over a single array (Atkinson et al.,
+ * "Min-Max Heaps and Generalized Priority Queues", 1986). Nodes on even
+ * levels are no greater than anything below them and nodes on odd levels
+ * no less, so the min is the root and the max one of its two children.
+ *
+ * Min and max follow the comparitor: cmp(a, b) < 0 means a is the min
+ * side. Always binary, BINARY_HEAP_ARITY does not apply. Grows like
+ * binary_heap_t, honouring BINARY_HEAP_RESIZE and
+ * BINARY_HEAP_INITIAL_CAPACITY, and allocates with BINARY_HEAP_ALLOC.
+ */
+
+/* Forward declare */
+typedef struct minmax_heap minmax_heap_t;
+
+
+int 	minmax_heap_new      (minmax_heap_t** out, compare_f cmp);
+void 	minmax_heap_destroy  (minmax_heap_t* heap);
+size_t	minmax_heap_size     (minmax_heap_t* heap);
+size_t	minmax_heap_comparisons(minmax_heap_t* heap);
+int 	minmax_heap_push     (minmax_heap_t* heap, void* data);
+int 	minmax_heap_peek_min (minmax_heap_t* heap, void** out);
+int 	minmax_heap_peek_max (minmax_heap_t* heap, void** out);
+int 	minmax_heap_pop_min  (minmax_heap_t* heap, void** out);
+int 	minmax_heap_pop_max  (minmax_heap_t* heap, void** out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MINMAX_HEAP_H */
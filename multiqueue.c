@@ -0,0 +1,292 @@
+/*
+ * multiqueue.c
+ * Copyright (C) 2016-2017 Chad Mowery
+ *
+ * 
+ * multiqueue.c is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multiqueue.c is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#define _POSIX_C_SOURCE 200112L
+
+#include "multiqueue.h"
+
+/* Uncomment to disable asserts
+ * #define NDEBUG */
+#include <assert.h>
+
+#include <pthread.h>
+
+/* Forware declarations */
+size_t random_shard(multiqueue_t* mq, multiqueue_rng_t* rng);
+size_t lock_random (multiqueue_t* mq, multiqueue_rng_t* rng);
+int    pop_any     (multiqueue_t* mq, void** out);
+
+/* Shards are padded to whole cache lines so neighbouring locks don't
+ * false share */
+#define MULTIQUEUE_SHARD_PAD 128
+
+typedef union multiqueue_shard {
+    struct {
+        pthread_mutex_t lock;
+        binary_heap_t*  heap;
+    } s;
+    unsigned char pad[MULTIQUEUE_SHARD_PAD];
+} multiqueue_shard_t;
+
+struct multiqueue {
+    compare_f cmp;
+
+    multiqueue_shard_t* shards;
+    size_t count;
+};
+
+/**
+ * Create a new multiqueue.
+ * O(m)
+ *
+ * @param[out] out      The out ptr to the new multiqueue
+ * @param[in]  cmp      The comparitor to use, shared by all shards
+ * @param[in]  shards   The number of shards m, at least 2, usually 2-4 per thread
+ * @return              1 if the multiqueue is created, otherwise 0
+ */
+int multiqueue_new(multiqueue_t** out, compare_f cmp, size_t shards)
+{
+    assert(out);
+    assert(cmp);
+    assert(shards >= 2);
+    assert(sizeof(((multiqueue_shard_t*)0)->s) <= MULTIQUEUE_SHARD_PAD);
+
+    *out = NULL;
+    multiqueue_t* mq = (multiqueue_t*)BINARY_HEAP_ALLOC(sizeof(multiqueue_t));
+    assert(mq);
+    if (!mq)
+        return 0;
+
+    mq->cmp = cmp;
+    mq->count = 0;
+    mq->shards = (multiqueue_shard_t*)BINARY_HEAP_ALLOC(shards * sizeof(multiqueue_shard_t));
+    assert(mq->shards);
+    if (!mq->shards) {
+        multiqueue_destroy(mq);
+        return 0;
+    }
+
+    for (; mq->count < shards; ++mq->count) {
+        multiqueue_shard_t* shard = &mq->shards[mq->count];
+
+        /* binary_heap_new leaves out alone when it fails */
+        shard->s.heap = NULL;
+        binary_heap_new(&shard->s.heap, cmp);
+        if (!shard->s.heap)
+            break;
+
+        if (pthread_mutex_init(&shard->s.lock, NULL) != 0) {
+            binary_heap_destroy(shard->s.heap);
+            break;
+        }
+    }
+
+    if (mq->count < shards) {
+        multiqueue_destroy(mq);
+        return 0;
+    }
+
+    *out = mq;
+    return 1;
+}
+
+/**
+ * Destroy a multiqueue, without freeing elements. No other thread may be
+ * using it.
+ * O(m)
+ *
+ * @param[in] mq    The multiqueue
+ */
+void multiqueue_destroy(multiqueue_t* mq)
+{
+    assert(mq);
+
+    size_t i;
+    for (i = 0; i < mq->count; ++i) {
+        pthread_mutex_destroy(&mq->shards[i].s.lock);
+        binary_heap_destroy(mq->shards[i].s.heap);
+    }
+
+    BINARY_HEAP_FREE(mq->shards);
+    BINARY_HEAP_FREE(mq);
+}
+
+/**
+ * Get the number of shards.
+ * O(1)
+ *
+ * @param[in] mq    The multiqueue
+ * @return          The number of shards
+ */
+size_t multiqueue_shards(multiqueue_t* mq)
+{
+    assert(mq);
+    return (mq->count);
+}
+
+/**
+ * Get the number of elements. Shards are locked one at a time, so with
+ * concurrent pushes and pops this is only a snapshot.
+ * O(m)
+ *
+ * @param[in] mq    The multiqueue
+ * @return          The number of elements
+ */
+size_t multiqueue_size(multiqueue_t* mq)
+{
+    assert(mq);
+
+    size_t size = 0;
+    size_t i;
+    for (i = 0; i < mq->count; ++i) {
+        pthread_mutex_lock(&mq->shards[i].s.lock);
+        size += binary_heap_size(mq->shards[i].s.heap);
+        pthread_mutex_unlock(&mq->shards[i].s.lock);
+    }
+
+    return (size);
+}
+
+/**
+ * Add a new data element to a random shard.
+ * O(logn)
+ *
+ * @param[in] mq    The multiqueue
+ * @param[in] data  The data element to add
+ * @param[in] rng   The calling thread's rng state
+ * @return          1 if the add is successful, otherwise 0
+ */
+int multiqueue_push(multiqueue_t* mq, void* data, multiqueue_rng_t* rng)
+{
+    assert(mq);
+    assert(rng);
+
+    size_t i = lock_random(mq, rng);
+    int success = binary_heap_push(mq->shards[i].s.heap, data);
+    pthread_mutex_unlock(&mq->shards[i].s.lock);
+
+    return (success);
+}
+
+/**
+ * Remove the better top of two random shards. Falls back to a sweep of
+ * every shard when both are empty, so 0 is only returned when the whole
+ * multiqueue was seen empty.
+ * O(logn)
+ *
+ * @param[in]  mq   The multiqueue
+ * @param[out] out  The out ptr to the removed data element
+ * @param[in]  rng  The calling thread's rng state
+ * @return          1 if an element was removed, otherwise 0
+ */
+int multiqueue_pop(multiqueue_t* mq, void** out, multiqueue_rng_t* rng)
+{
+    assert(mq);
+    assert(out);
+    assert(rng);
+
+    size_t a = lock_random(mq, rng);
+
+    /* Only try the second shard, holding the first while blocking on it
+     * could deadlock against another popper */
+    size_t b = random_shard(mq, rng);
+    if (b == a || pthread_mutex_trylock(&mq->shards[b].s.lock) != 0)
+        b = a;
+
+    binary_heap_t* heap_a = mq->shards[a].s.heap;
+    binary_heap_t* heap_b = mq->shards[b].s.heap;
+    binary_heap_t* best = heap_a;
+
+    void* top_a = NULL;
+    void* top_b = NULL;
+    binary_heap_peek(heap_a, &top_a);
+    binary_heap_peek(heap_b, &top_b);
+    if (binary_heap_size(heap_a) == 0 || (binary_heap_size(heap_b) > 0 && mq->cmp(top_b, top_a) < 0))
+        best = heap_b;
+
+    int popped = (binary_heap_size(best) > 0);
+    if (popped)
+        binary_heap_pop(best, out);
+
+    pthread_mutex_unlock(&mq->shards[a].s.lock);
+    if (b != a)
+        pthread_mutex_unlock(&mq->shards[b].s.lock);
+
+    return (popped ? 1 : pop_any(mq, out));
+}
+
+/**
+ * Pick a uniformly random shard, advancing the xorshift rng state.
+ *
+ * @param[in] mq    The multiqueue
+ * @param[in] rng   The calling thread's rng state
+ * @return          The shard index
+ */
+size_t random_shard(multiqueue_t* mq, multiqueue_rng_t* rng)
+{
+    uint64_t x = (*rng ? *rng : 88172645463325252ULL);
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *rng = x;
+
+    return ((size_t)(x % mq->count));
+}
+
+/**
+ * Lock a random shard, trying other random shards while the chosen ones
+ * are busy.
+ *
+ * @param[in] mq    The multiqueue
+ * @param[in] rng   The calling thread's rng state
+ * @return          The index of the locked shard
+ */
+size_t lock_random(multiqueue_t* mq, multiqueue_rng_t* rng)
+{
+    for (;;) {
+        size_t i = random_shard(mq, rng);
+        if (pthread_mutex_trylock(&mq->shards[i].s.lock) == 0)
+            return (i);
+    }
+}
+
+/**
+ * Pop the top of the first non-empty shard, locking each in turn.
+ *
+ * @param[in]  mq   The multiqueue
+ * @param[out] out  The out ptr to the removed data element
+ * @return          1 if an element was removed, otherwise 0
+ */
+int pop_any(multiqueue_t* mq, void** out)
+{
+    size_t i;
+    for (i = 0; i < mq->count; ++i) {
+        binary_heap_t* heap = mq->shards[i].s.heap;
+
+        pthread_mutex_lock(&mq->shards[i].s.lock);
+        int popped = (binary_heap_size(heap) > 0);
+        if (popped)
+            binary_heap_pop(heap, out);
+        pthread_mutex_unlock(&mq->shards[i].s.lock);
+
+        if (popped)
+            return 1;
+    }
+
+    return 0;
+}
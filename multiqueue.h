@@ -0,0 +1,64 @@
+/*
+ * multiqueue.h
+ * Copyright (C) 2016-2017 Chad Mowery
+ *
+ * 
+ * multiqueue.h is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * multiqueue.h is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MULTIQUEUE_H
+#define MULTIQUEUE_H
+
+#include "binaryheap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Relaxed concurrent priority queue made of binary_heap_t shards, each
+ * behind its own mutex. Push locks a random shard. Pop locks two random
+ * shards and pops the better of their tops. Locks are only ever tried,
+ * so a busy shard is skipped for another random one instead of waited on.
+ *
+ * Pops are relaxed: they return a near-top element, not always the top.
+ * With m shards, the rank of a popped element among all elements in the
+ * queue is O(m) in expectation and O(m log m) with high probability
+ * (Alistarh et al., "The Power of Choice in Priority Scheduling", 2017).
+ * Use m = c * P for P threads, with c = 2 to 4. Larger c means less lock
+ * contention but more rank error. Per-thread FIFO order is not kept.
+ *
+ * All calls except new and destroy are thread safe. Each thread passes
+ * its own rng state, any non-zero seed, so no state is shared for the
+ * random shard choice.
+ */
+
+/* Forward declare */
+typedef struct multiqueue multiqueue_t;
+
+/* Per-thread random state for shard choice */
+typedef uint64_t multiqueue_rng_t;
+
+
+int 	multiqueue_new    (multiqueue_t** out, compare_f cmp, size_t shards);
+void 	multiqueue_destroy(multiqueue_t* mq);
+size_t	multiqueue_shards (multiqueue_t* mq);
+size_t	multiqueue_size   (multiqueue_t* mq);
+int 	multiqueue_push   (multiqueue_t* mq, void* data, multiqueue_rng_t* rng);
+int 	multiqueue_pop    (multiqueue_t* mq, void** out, multiqueue_rng_t* rng);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MULTIQUEUE_H */
@@ -16,10 +16,19 @@
  * You should have received a copy of the GNU Lesser General Public License
  * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
  */
+#define _POSIX_C_SOURCE 200112L
+
 #include "binaryheap.h"
+#include "heapalloc.h"
+#include "extheap.h"
+#include "kmerge.h"
+#include "minmaxheap.h"
+#include "multiqueue.h"
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <string.h>
 
 /* NOTE: All tests assume minheap comparisons */
 
@@ -291,7 +300,12 @@ void visit(void* elem)
     assert(elem && "Expected non-NULL element in visitor");
     assert(idx < 10);
 
+#if BINARY_HEAP_ARITY == 2
     assert(*(int*)elem == expected_traverse[idx++]);
+#else
+    /* Array order depends on the arity, only the root is fixed */
+    assert((idx++ > 0 || *(int*)elem == 1) && "Expected root value [1]");
+#endif
 }
 
 void test_binary_heap_traverse()
@@ -316,6 +330,1661 @@ void test_binary_heap_traverse()
     binary_heap_destroy_free(heap);
 }
 
+void test_binary_heap_new_from_array()
+{
+    int values[10] = { 10, 4, 7, 9, 8, 6, 2, 3, 5, 1 };
+    void* data[10];
+
+    size_t i;
+    for (i = 0; i < 10; ++i)
+        data[i] = elem_new(values[i]);
+
+    binary_heap_t* heap;
+    binary_heap_new_from_array(&heap, &min, data, 10);
+
+    assert(heap && "Failed to construct new binary_heap_t from array");
+    assert(binary_heap_size(heap) == 10 && "Expected heap size of [10]");
+    assert(binary_heap_capacity(heap) == BINARY_HEAP_INITIAL_CAPACITY && "Expected heap capacity of BINARY_HEAP_INITIAL_CAPACITY [20]");
+    assert(*(int*)data[0] == 10 && "Expected source array to be left untouched");
+
+    void* top = NULL;
+    for (i = 1; i <= 10; ++i) {
+        binary_heap_pop(heap, &top);
+        assert(*(int*)top == (int)i && "Expected pops in ascending order");
+        free(top);
+    }
+    assert(binary_heap_size(heap) == 0 && "Expected heap size of [0]");
+
+    binary_heap_destroy_free(heap);
+}
+
+void test_binary_heap_heapify()
+{
+    size_t count = BINARY_HEAP_INITIAL_CAPACITY * 3;
+    void** data = (void**)BINARY_HEAP_ALLOC(count * sizeof(void*));
+
+    assert(data && "Failed to malloc an element array");
+
+    /* Interleave high and low values so nothing starts out in order */
+    size_t i;
+    for (i = 0; i < count; ++i)
+        data[i] = elem_new((int)(i % 2 ? i : count - i));
+
+    binary_heap_t* heap;
+    binary_heap_adopt_array(&heap, &min, data, count, count);
+
+    assert(heap && "Failed to construct new binary_heap_t from adopted array");
+    assert(binary_heap_size(heap) == count && "Expected heap size of [60]");
+    assert(binary_heap_capacity(heap) == count && "Expected heap capacity of [60]");
+
+    /* Reverse the priorities of the stored elements then restore order */
+    for (i = 0; i < count; ++i)
+        *(int*)data[i] = -*(int*)data[i];
+    binary_heap_heapify(heap);
+
+    void* top = NULL;
+    int last = -(int)count - 1;
+    for (i = 0; i < count; ++i) {
+        binary_heap_pop(heap, &top);
+        assert(*(int*)top >= last && "Expected pops in ascending order");
+        last = *(int*)top;
+        free(top);
+    }
+    assert(last == -1 && "Expected last pop value [-1]");
+
+    binary_heap_destroy_free(heap);
+}
+
+void test_binary_heap_push_n_pop_n()
+{
+    binary_heap_t* heap;
+    binary_heap_new(&heap, &min);
+
+    void* batch[50];
+    size_t i;
+
+    /* A large batch into an empty heap is heapified */
+    for (i = 0; i < 50; ++i)
+        batch[i] = elem_new((int)(100 - i * 2));
+    assert(1 == binary_heap_push_n(heap, batch, 50) && "Expected successful batch push");
+    assert(binary_heap_size(heap) == 50 && "Expected heap size of [50]");
+    assert(binary_heap_capacity(heap) == BINARY_HEAP_INITIAL_CAPACITY * 4 && "Expected a single resize to BINARY_HEAP_INITIAL_CAPACITY * 4 [80]");
+
+    /* A small batch into a larger heap is bubbled up */
+    for (i = 0; i < 3; ++i)
+        batch[i] = elem_new((int)(i * 2 + 1));
+    assert(1 == binary_heap_push_n(heap, batch, 3) && "Expected successful batch push");
+    assert(binary_heap_size(heap) == 53 && "Expected heap size of [53]");
+
+    void* top = NULL;
+    binary_heap_peek(heap, &top);
+    assert(*(int*)top == 1 && "Expected peek value [1]");
+
+    void* out[60];
+    assert(binary_heap_pop_n(heap, out, 5) == 5 && "Expected 5 popped elements");
+    assert(*(int*)out[0] == 1 && "Expected pop value [1]");
+    assert(*(int*)out[1] == 2 && "Expected pop value [2]");
+    assert(*(int*)out[2] == 3 && "Expected pop value [3]");
+    assert(*(int*)out[3] == 4 && "Expected pop value [4]");
+    assert(*(int*)out[4] == 5 && "Expected pop value [5]");
+    assert(binary_heap_size(heap) == 48 && "Expected heap size of [48]");
+
+    for (i = 0; i < 5; ++i)
+        free(out[i]);
+
+    /* Asking for more than the heap holds drains it */
+    assert(binary_heap_pop_n(heap, out, 60) == 48 && "Expected 48 popped elements");
+    assert(binary_heap_size(heap) == 0 && "Expected heap size of [0]");
+    for (i = 0; i < 48; ++i) {
+        assert(*(int*)out[i] == (int)(i * 2 + 6) && "Expected pops in ascending order");
+        free(out[i]);
+    }
+
+    binary_heap_destroy_free(heap);
+}
+
+/* Test element stored by value in sized heaps */
+typedef struct job
+{
+    int    priority;
+    double payload[3];
+} job_t;
+
+int job_min(void* a, void* b)
+{
+    return (((job_t*)a)->priority - ((job_t*)b)->priority);
+}
+
+void test_binary_heap_sized()
+{
+    binary_heap_t* heap;
+    binary_heap_new_sized(&heap, sizeof(int), &min);
+
+    assert(heap && "Failed to construct new sized binary_heap_t");
+    assert(binary_heap_size(heap) == 0 && "Expected initial heap size of 0");
+    assert(binary_heap_capacity(heap) == BINARY_HEAP_INITIAL_CAPACITY && "Expected initial heap capacity of BINARY_HEAP_INITIAL_CAPACITY [20]");
+
+    void* top = NULL;
+    binary_heap_peek(heap, &top);
+    assert(top == NULL && "Expected peek value [NULL]");
+
+    int values[10] = { 10, 4, 7, 9, 8, 6, 2, 3, 5, 1 };
+    size_t i;
+    for (i = 0; i < 10; ++i)
+        assert(1 == binary_heap_push_value(heap, &values[i]) && "Expected successful heap push");
+
+    /* Elements are copied, so the source can change freely */
+    values[9] = 100;
+
+    binary_heap_peek(heap, &top);
+    assert(*(int*)top == 1 && "Expected peek value [1]");
+
+    /* Sized heaps keep the same array order as pointer heaps */
+    idx = 0;
+    binary_heap_traverse(heap, &visit);
+
+    int value = 0;
+    for (i = 1; i <= 10; ++i) {
+        assert(1 == binary_heap_pop_value(heap, &value) && "Expected successful heap pop");
+        assert(value == (int)i && "Expected pops in ascending order");
+    }
+
+    value = -1;
+    assert(0 == binary_heap_pop_value(heap, &value) && "Expected pop from empty heap to fail");
+    assert(value == -1 && "Expected pop from empty heap to leave out untouched");
+
+    binary_heap_destroy_free(heap);
+
+    /* Larger elements survive resizes intact */
+    binary_heap_new_sized(&heap, sizeof(job_t), &job_min);
+
+    job_t job;
+    for (i = 0; i < BINARY_HEAP_INITIAL_CAPACITY * 2 + 1; ++i) {
+        job.priority = (int)((i * 7) % 41);
+        job.payload[0] = job.payload[1] = job.payload[2] = (double)job.priority;
+        assert(1 == binary_heap_push_value(heap, &job) && "Expected successful heap push");
+    }
+    assert(binary_heap_capacity(heap) == BINARY_HEAP_INITIAL_CAPACITY * 4 && "Expected heap capacity of BINARY_HEAP_INITIAL_CAPACITY * 4 [80]");
+
+    for (i = 0; i < BINARY_HEAP_INITIAL_CAPACITY * 2 + 1; ++i) {
+        binary_heap_pop_value(heap, &job);
+        assert(job.priority == (int)i && "Expected pops in ascending order");
+        assert(job.payload[2] == (double)i && "Expected payload to move with its element");
+    }
+
+    binary_heap_destroy(heap);
+}
+
+void test_binary_heap_keyed()
+{
+    binary_heap_t* heap;
+    binary_heap_new_keyed(&heap);
+
+    assert(heap && "Failed to construct new keyed binary_heap_t");
+
+    void* top = NULL;
+    uint64_t key = 0;
+    binary_heap_peek(heap, &top);
+    assert(top == NULL && "Expected peek value [NULL]");
+    assert(0 == binary_heap_peek_key(heap, &key) && "Expected no key on an empty heap");
+
+    /* Keys above 2^32 must order correctly */
+    uint64_t keys[10] = { 10, 4, 7, 9, 8, 6, 2, 3, 5, 1 };
+    size_t i;
+    for (i = 0; i < 10; ++i)
+        assert(1 == binary_heap_push_key(heap, keys[i] << 33, elem_new((int)keys[i])) && "Expected successful heap push");
+
+    /* Keyed heaps keep the same array order as pointer heaps */
+    idx = 0;
+    binary_heap_traverse(heap, &visit);
+
+    for (i = 1; i <= 10; ++i) {
+        assert(1 == binary_heap_peek_key(heap, &key) && "Expected a top-most key");
+        assert(key == (uint64_t)i << 33 && "Expected keys in ascending order");
+        binary_heap_pop(heap, &top);
+        assert(*(int*)top == (int)i && "Expected payloads in key order");
+        free(top);
+    }
+    assert(binary_heap_size(heap) == 0 && "Expected heap size of [0]");
+
+    binary_heap_destroy_free(heap);
+
+    binary_heap_new_keyed_double(&heap);
+
+    double dkey = 0.0;
+    for (i = 0; i < BINARY_HEAP_INITIAL_CAPACITY * 2 + 1; ++i)
+        binary_heap_push_key_double(heap, ((int)i - 20) * 0.5, elem_new((int)i));
+    assert(binary_heap_capacity(heap) == BINARY_HEAP_INITIAL_CAPACITY * 4 && "Expected heap capacity of BINARY_HEAP_INITIAL_CAPACITY * 4 [80]");
+
+    assert(1 == binary_heap_peek_key_double(heap, &dkey) && "Expected a top-most key");
+    assert(dkey == -10.0 && "Expected peek key [-10.0]");
+
+    binary_heap_pop(heap, &top);
+    assert(*(int*)top == 0 && "Expected pop value [0]");
+    free(top);
+
+    binary_heap_pop(heap, &top);
+    assert(*(int*)top == 1 && "Expected pop value [1]");
+    free(top);
+
+    binary_heap_destroy_free(heap);
+}
+
+void test_binary_heap_bottom_up()
+{
+    binary_heap_t* top_down;
+    binary_heap_t* bottom_up;
+    binary_heap_new(&top_down, &min);
+    binary_heap_new(&bottom_up, &min);
+    binary_heap_set_bottom_up(top_down, 0);
+    binary_heap_set_bottom_up(bottom_up, 1);
+
+    assert(binary_heap_comparisons(top_down) == 0 && "Expected no comparisons on a new heap");
+
+    /* Same pseudo random elements, with duplicates, in both heaps */
+    int values[1000];
+    size_t i;
+    for (i = 0; i < 1000; ++i) {
+        values[i] = (int)((i * 7919) % 503);
+        binary_heap_push(top_down, &values[i]);
+        binary_heap_push(bottom_up, &values[i]);
+    }
+    assert(binary_heap_comparisons(top_down) == binary_heap_comparisons(bottom_up) && "Expected pushes to compare the same way");
+
+    size_t pushed = binary_heap_comparisons(top_down);
+
+    void* a = NULL;
+    void* b = NULL;
+    int last = -1;
+    for (i = 0; i < 1000; ++i) {
+        binary_heap_pop(top_down, &a);
+        binary_heap_pop(bottom_up, &b);
+        assert(*(int*)a == *(int*)b && "Expected both pop modes to pop the same order");
+        assert(*(int*)a >= last && "Expected pops in ascending order");
+        last = *(int*)a;
+    }
+
+    size_t top_down_pops = binary_heap_comparisons(top_down) - pushed;
+    size_t bottom_up_pops = binary_heap_comparisons(bottom_up) - pushed;
+    /* Saves one comparison per level, out of arity per level top-down */
+#if !BINARY_HEAP_COUNT_COMPARISONS
+    assert(top_down_pops == 0 && bottom_up_pops == 0 && "Expected no comparisons counted");
+#elif BINARY_HEAP_ARITY == 2
+    assert(bottom_up_pops * 4 < top_down_pops * 3 && "Expected bottom-up pops to save at least a quarter of comparisons");
+#else
+    assert(bottom_up_pops < top_down_pops && "Expected bottom-up pops to save comparisons");
+#endif
+
+    binary_heap_destroy(top_down);
+    binary_heap_destroy(bottom_up);
+}
+
+void test_binary_heap_handles()
+{
+    binary_heap_t* heap;
+    binary_heap_new(&heap, &min);
+    assert(1 == binary_heap_track_handles(heap) && "Expected handle tracking to be enabled");
+
+    /* Enough elements to force a resize of the handle arrays */
+    int values[BINARY_HEAP_INITIAL_CAPACITY * 2];
+    binary_heap_handle_t handles[BINARY_HEAP_INITIAL_CAPACITY * 2];
+    size_t i;
+    for (i = 0; i < BINARY_HEAP_INITIAL_CAPACITY * 2; ++i) {
+        values[i] = (int)(i * 10);
+        handles[i] = binary_heap_push_handle(heap, &values[i]);
+        assert(handles[i] == i && "Expected handles in push order");
+    }
+
+    /* Decrease key */
+    values[30] = -1;
+    binary_heap_update(heap, handles[30]);
+    void* top = NULL;
+    binary_heap_peek(heap, &top);
+    assert(top == &values[30] && "Expected decreased element at the top");
+
+    /* Increase key, updating after each change */
+    values[30] = 1000;
+    binary_heap_update(heap, handles[30]);
+    values[0] = 995;
+    binary_heap_update(heap, handles[0]);
+    binary_heap_peek(heap, &top);
+    assert(top == &values[1] && "Expected pop value [10] after increase keys");
+
+    /* Remove from the middle */
+    binary_heap_remove(heap, handles[15], &top);
+    assert(top == &values[15] && "Expected removed element [150]");
+    assert(!binary_heap_contains(heap, handles[15]) && "Expected removed handle to be gone");
+    assert(binary_heap_contains(heap, handles[16]) && "Expected other handles to stay valid");
+    assert(binary_heap_size(heap) == BINARY_HEAP_INITIAL_CAPACITY * 2 - 1 && "Expected heap size of [39]");
+
+    /* Freed handles are reused */
+    assert(binary_heap_push_handle(heap, &values[15]) == handles[15] && "Expected removed handle to be reused");
+
+    int last = -2;
+    for (i = 0; i < BINARY_HEAP_INITIAL_CAPACITY * 2; ++i) {
+        binary_heap_pop(heap, &top);
+        assert(*(int*)top > last && "Expected pops in ascending order");
+        last = *(int*)top;
+    }
+    assert(last == 1000 && "Expected last pop value [1000]");
+    assert(!binary_heap_contains(heap, handles[30]) && "Expected popped handle to be gone");
+
+    binary_heap_destroy(heap);
+
+    /* Keyed heaps update their cached keys */
+    binary_heap_new_keyed(&heap);
+    binary_heap_track_handles(heap);
+
+    for (i = 0; i < 10; ++i)
+        handles[i] = binary_heap_push_key_handle(heap, 100 + i, &values[i]);
+
+    binary_heap_update_key(heap, handles[7], 1);
+    binary_heap_update_key(heap, handles[0], 500);
+
+    uint64_t key = 0;
+    binary_heap_peek_key(heap, &key);
+    assert(key == 1 && "Expected peek key [1]");
+
+    binary_heap_remove(heap, handles[7], NULL);
+    binary_heap_peek_key(heap, &key);
+    assert(key == 101 && "Expected peek key [101]");
+
+    binary_heap_destroy(heap);
+}
+
+/* Test worker, pushes its slice of the elements then pops as many */
+typedef struct mq_worker {
+    multiqueue_t* mq;
+    int* values;
+    size_t count;
+    long popped_sum;
+} mq_worker_t;
+
+void* mq_work(void* arg)
+{
+    mq_worker_t* worker = (mq_worker_t*)arg;
+    multiqueue_rng_t rng = (multiqueue_rng_t)(size_t)worker->values + 1;
+
+    size_t i;
+    for (i = 0; i < worker->count; ++i)
+        assert(multiqueue_push(worker->mq, &worker->values[i], &rng) && "Expected successful multiqueue push");
+
+    void* out = NULL;
+    for (i = 0; i < worker->count; ++i) {
+        assert(multiqueue_pop(worker->mq, &out, &rng) && "Expected successful multiqueue pop");
+        worker->popped_sum += *(int*)out;
+    }
+
+    return NULL;
+}
+
+void test_multiqueue()
+{
+    multiqueue_t* mq;
+    assert(multiqueue_new(&mq, &min, 8) && "Failed to construct new multiqueue_t");
+    assert(multiqueue_shards(mq) == 8 && "Expected [8] shards");
+
+    multiqueue_rng_t rng = 1;
+    void* out = NULL;
+    assert(!multiqueue_pop(mq, &out, &rng) && "Expected pop from empty multiqueue to fail");
+
+    /* Pops are relaxed, but stay close to the true order */
+    int values[1000];
+    size_t i;
+    for (i = 0; i < 1000; ++i) {
+        values[i] = (int)((i * 7919) % 1000);
+        multiqueue_push(mq, &values[i], &rng);
+    }
+    assert(multiqueue_size(mq) == 1000 && "Expected multiqueue size of [1000]");
+
+    int seen[1000] = { 0 };
+    size_t total_rank_error = 0;
+    for (i = 0; i < 1000; ++i) {
+        assert(multiqueue_pop(mq, &out, &rng) && "Expected successful multiqueue pop");
+        int value = *(int*)out;
+        assert(!seen[value] && "Expected every element to pop once");
+        seen[value] = 1;
+
+        /* Every smaller element still queued adds one to the rank */
+        int smaller;
+        for (smaller = 0; smaller < value; ++smaller)
+            total_rank_error += !seen[smaller];
+    }
+    assert(total_rank_error < 1000 * 8 && "Expected mean rank error below the shard count");
+    assert(!multiqueue_pop(mq, &out, &rng) && "Expected multiqueue to be empty");
+
+    /* Concurrent pushes and pops lose nothing */
+    int shared[4000];
+    long expected_sum = 0;
+    for (i = 0; i < 4000; ++i) {
+        shared[i] = (int)i;
+        expected_sum += (long)i;
+    }
+
+    pthread_t threads[4];
+    mq_worker_t workers[4];
+    for (i = 0; i < 4; ++i) {
+        workers[i].mq = mq;
+        workers[i].values = &shared[i * 1000];
+        workers[i].count = 1000;
+        workers[i].popped_sum = 0;
+        pthread_create(&threads[i], NULL, &mq_work, &workers[i]);
+    }
+
+    long popped_sum = 0;
+    for (i = 0; i < 4; ++i) {
+        pthread_join(threads[i], NULL);
+        popped_sum += workers[i].popped_sum;
+    }
+    assert(popped_sum == expected_sum && "Expected every element to pop once across threads");
+    assert(multiqueue_size(mq) == 0 && "Expected multiqueue size of [0]");
+
+    multiqueue_destroy(mq);
+}
+
+/* Test allocator, counts live bytes using the sizes the heap passes */
+void* counting_alloc(void* ctx, size_t size)
+{
+    *(size_t*)ctx += size;
+    return malloc(size);
+}
+
+void* counting_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size)
+{
+    *(size_t*)ctx += new_size - old_size;
+    return realloc(ptr, new_size);
+}
+
+void counting_free(void* ctx, void* ptr, size_t size)
+{
+    *(size_t*)ctx -= size;
+    free(ptr);
+}
+
+void test_binary_heap_allocator()
+{
+    binary_heap_allocator_t counting = { &counting_alloc, &counting_realloc, &counting_free };
+    size_t live = 0;
+    int values[100];
+    void* top = NULL;
+    size_t i;
+    for (i = 0; i < 100; ++i)
+        values[i] = (int)((i * 37) % 100);
+
+    binary_heap_t* heap;
+    binary_heap_new_with_allocator(&heap, &min, &counting, &live);
+    assert(live > 0 && "Expected the heap to allocate from its allocator");
+
+    binary_heap_track_handles(heap);
+    for (i = 0; i < 100; ++i)
+        binary_heap_push(heap, &values[i]);
+    binary_heap_pop(heap, &top);
+    assert(*(int*)top == 0 && "Expected pop value [0]");
+
+    binary_heap_destroy(heap);
+    assert(live == 0 && "Expected every allocated byte to be freed");
+
+    /* Arena, growing the most recent allocation in place */
+    static unsigned char arena_buffer[4096];
+    binary_heap_arena_t arena;
+    binary_heap_arena_init(&arena, arena_buffer, sizeof(arena_buffer));
+
+    binary_heap_new_with_allocator(&heap, &min, &binary_heap_arena_allocator, &arena);
+    for (i = 0; i < 100; ++i)
+        assert(binary_heap_push(heap, &values[i]) && "Expected successful heap push");
+    assert(binary_heap_capacity(heap) == BINARY_HEAP_INITIAL_CAPACITY * 8 && "Expected heap capacity of [160]");
+    assert(binary_heap_arena_used(&arena) < sizeof(arena_buffer) / 2 && "Expected storage to grow in place");
+
+    for (i = 0; i < 100; ++i) {
+        binary_heap_pop(heap, &top);
+        assert(*(int*)top == (int)i && "Expected pops in ascending order");
+    }
+
+    binary_heap_arena_reset(&arena);
+    assert(binary_heap_arena_used(&arena) == 0 && "Expected an empty arena after reset");
+
+    /* Pool, many short-lived heaps reusing the same blocks */
+    static unsigned char pool_buffer[8 * 512];
+    binary_heap_pool_t pool;
+    size_t blocks = binary_heap_pool_init(&pool, pool_buffer, sizeof(pool_buffer), 512);
+    assert(blocks >= 7 && "Expected at least [7] pool blocks");
+
+    size_t round;
+    for (round = 0; round < 1000; ++round) {
+        binary_heap_new_with_allocator(&heap, &min, &binary_heap_pool_allocator, &pool);
+        for (i = 0; i < 10; ++i)
+            binary_heap_push(heap, &values[(round + i) % 100]);
+        binary_heap_destroy(heap);
+    }
+    assert(binary_heap_pool_available(&pool) == blocks && "Expected every block back in the pool");
+
+    /* Growing past a block fails without losing the heap */
+    binary_heap_new_with_allocator(&heap, &min, &binary_heap_pool_allocator, &pool);
+    for (i = 0; i < 100; ++i) {
+        if (!binary_heap_push(heap, &values[i]))
+            break;
+    }
+    assert(i < 100 && "Expected a push to fail once the heap outgrows its block");
+    assert(binary_heap_size(heap) == i && "Expected the failed push to leave the heap intact");
+    binary_heap_pop(heap, &top);
+    assert(*(int*)top == 0 && "Expected pop value [0]");
+
+    binary_heap_destroy(heap);
+    assert(binary_heap_pool_available(&pool) == blocks && "Expected every block back in the pool");
+}
+
+void test_binary_heap_stats()
+{
+    binary_heap_t* heap;
+    binary_heap_new(&heap, &min);
+
+    int values[100];
+    size_t i;
+    for (i = 0; i < 100; ++i) {
+        values[i] = (int)(100 - i);
+        binary_heap_push(heap, &values[i]);
+    }
+
+    void* out;
+    for (i = 0; i < 50; ++i)
+        binary_heap_pop(heap, &out);
+
+    binary_heap_stats_t stats;
+    int enabled = binary_heap_stats(heap, &stats);
+    assert(stats.comparisons == binary_heap_comparisons(heap) && "Expected stats to count comparisons");
+
+    if (!enabled) {
+        assert(stats.moves == 0 && stats.resizes == 0 && stats.max_size == 0 && "Expected other stats to be 0 when disabled");
+        binary_heap_destroy(heap);
+        return;
+    }
+
+    /* 20 -> 40 -> 80 -> 160 */
+    assert(stats.resizes == 3 && "Expected [3] resizes");
+    assert(stats.bytes_reallocated >= (40 + 80 + 160) * sizeof(void*) && "Expected the grown blocks to be counted");
+    assert(stats.max_size == 100 && "Expected max size of [100]");
+    assert(stats.moves > 100 && "Expected moves to be counted");
+
+    /* Reverse order pushes all sift to the root but the first, pops sift
+     * back down */
+    size_t sifts = 0;
+    for (i = 0; i < BINARY_HEAP_STATS_BUCKETS; ++i)
+        sifts += stats.sift_depth[i];
+    assert(sifts == 100 + 50 && "Expected one histogram entry per sift");
+    assert(stats.sift_depth[0] == 1 && "Expected only the first push not to move");
+
+    binary_heap_destroy(heap);
+
+    /* In order pushes never move, each is a sift of 0 levels */
+    binary_heap_new(&heap, &min);
+    for (i = 0; i < 100; ++i)
+        binary_heap_push(heap, &values[99 - i]);
+    binary_heap_stats(heap, &stats);
+    assert(stats.sift_depth[0] == 100 && "Expected [100] sifts in bucket 0");
+    binary_heap_destroy(heap);
+
+    /* Refused pushes never count towards max size */
+    void* batch[5] = { &values[0], &values[1], &values[2], &values[3], &values[4] };
+    binary_heap_new_bounded(&heap, &min, 4);
+    for (i = 0; i < 4; ++i)
+        binary_heap_push(heap, &values[i]);
+    assert(!binary_heap_push(heap, &values[4]) && "Expected push past the bound to fail");
+    assert(!binary_heap_push_n(heap, batch, 5) && "Expected push_n past the bound to fail");
+    binary_heap_stats(heap, &stats);
+    assert(stats.max_size == 4 && "Expected max size of [4]");
+    binary_heap_destroy(heap);
+}
+
+void test_binary_heap_merge()
+{
+    binary_heap_t* dst;
+    binary_heap_t* src;
+    binary_heap_new(&dst, &min);
+    binary_heap_new(&src, &min);
+
+    /* Evens in dst, odds in src */
+    int values[200];
+    size_t i;
+    for (i = 0; i < 200; ++i)
+        values[i] = (int)i;
+    for (i = 0; i < 100; ++i)
+        binary_heap_push(dst, &values[i * 2]);
+    for (i = 0; i < 5; ++i)
+        binary_heap_push(src, &values[i * 2 + 1]);
+
+    /* Small into large bubbles up the appended elements */
+    assert(1 == binary_heap_merge(dst, src) && "Expected successful merge");
+    assert(binary_heap_size(dst) == 105 && "Expected heap size of [105]");
+    assert(binary_heap_size(src) == 0 && "Expected merged heap to be empty");
+
+    /* Large into small re-heapifies, and src is reusable */
+    for (i = 5; i < 100; ++i)
+        assert(binary_heap_push(src, &values[i * 2 + 1]) && "Expected emptied heap to be reusable");
+    assert(1 == binary_heap_merge(src, dst) && "Expected successful merge");
+    assert(binary_heap_size(src) == 200 && "Expected heap size of [200]");
+    assert(binary_heap_capacity(src) == BINARY_HEAP_INITIAL_CAPACITY * 16 && "Expected a single grow to [320]");
+
+    void* top = NULL;
+    for (i = 0; i < 200; ++i) {
+        binary_heap_pop(src, &top);
+        assert(*(int*)top == (int)i && "Expected pops in ascending order");
+    }
+
+    /* Drained heaps have no storage, merging one in changes nothing */
+    for (i = 0; i < 10; ++i)
+        binary_heap_push(src, &values[i]);
+    size_t count;
+    BINARY_HEAP_FREE(binary_heap_drain_sorted(src, &count));
+    assert(binary_heap_capacity(src) == 0 && "Expected a drained heap without storage");
+    binary_heap_push(dst, &values[0]);
+    assert(1 == binary_heap_merge(dst, src) && "Expected merging a drained heap to succeed");
+    assert(binary_heap_size(dst) == 1 && "Expected heap size of [1]");
+
+    binary_heap_destroy(dst);
+    binary_heap_destroy(src);
+
+    /* Keyed heaps with handles give moved elements new handles */
+    binary_heap_new_keyed(&dst);
+    binary_heap_new_keyed(&src);
+    binary_heap_track_handles(dst);
+    binary_heap_track_handles(src);
+
+    binary_heap_push_key_handle(dst, 10, &values[10]);
+    binary_heap_handle_t moved = binary_heap_push_key_handle(src, 5, &values[5]);
+    binary_heap_push_key_handle(src, 20, &values[20]);
+
+    assert(1 == binary_heap_merge(dst, src) && "Expected successful merge");
+    assert(!binary_heap_contains(src, moved) && "Expected src handles to be invalid");
+    assert(binary_heap_contains(dst, 2) && "Expected moved elements to get dst handles");
+
+    uint64_t key = 0;
+    binary_heap_peek_key(dst, &key);
+    assert(key == 5 && "Expected peek key [5]");
+
+    binary_heap_destroy(dst);
+    binary_heap_destroy(src);
+}
+
+void test_binary_heap_bounded()
+{
+    binary_heap_t* heap;
+    binary_heap_new_bounded(&heap, &min, 10);
+
+    assert(heap && "Failed to construct new bounded binary_heap_t");
+    assert(binary_heap_capacity(heap) == 10 && "Expected heap capacity of [10]");
+
+    /* Keep the 10 largest of 0..999, offered in a scrambled order */
+    int values[1000];
+    size_t i;
+    size_t kept = 0;
+    void* evicted = NULL;
+    for (i = 0; i < 1000; ++i) {
+        values[i] = (int)((i * 7919) % 1000);
+        kept += binary_heap_offer(heap, &values[i], &evicted);
+        if (i < 10)
+            assert(evicted == NULL && "Expected no eviction while filling");
+    }
+    assert(kept < 1000 && "Expected rejected candidates");
+    assert(binary_heap_size(heap) == 10 && "Expected heap size of [10]");
+    assert(binary_heap_capacity(heap) == 10 && "Expected storage to never grow");
+
+    /* The root is the worst kept element and is rejected against directly */
+    size_t before = binary_heap_comparisons(heap);
+    assert(0 == binary_heap_offer(heap, &values[0], &evicted) && "Expected a small candidate to be rejected");
+    assert(binary_heap_comparisons(heap) == before + BINARY_HEAP_COUNT_COMPARISONS && "Expected a rejection to cost one comparison");
+
+    int big = 5000;
+    assert(1 == binary_heap_offer(heap, &big, &evicted) && "Expected a large candidate to be kept");
+    assert(*(int*)evicted == 990 && "Expected the smallest kept element [990] to be evicted");
+
+    int other = 4000;
+    assert(0 == binary_heap_push(heap, &other) && "Expected push past the bound to fail");
+
+    void* top = NULL;
+    for (i = 991; i < 1000; ++i) {
+        binary_heap_pop(heap, &top);
+        assert(*(int*)top == (int)i && "Expected the largest elements in ascending order");
+    }
+    binary_heap_pop(heap, &top);
+    assert(*(int*)top == 5000 && "Expected pop value [5000]");
+
+    binary_heap_destroy(heap);
+
+    /* Keyed top-k */
+    binary_heap_new_keyed_bounded(&heap, 3);
+    for (i = 0; i < 1000; ++i)
+        binary_heap_offer_key(heap, (uint64_t)values[i] << 20, &values[i], NULL);
+
+    uint64_t key = 0;
+    binary_heap_peek_key(heap, &key);
+    assert(key == (uint64_t)997 << 20 && "Expected smallest kept key [997 << 20]");
+
+    binary_heap_destroy(heap);
+}
+
+void test_binary_heap_pushpop_replace()
+{
+    binary_heap_t* heap;
+    binary_heap_new(&heap, &min);
+
+    int values[10] = { 10, 40, 70, 90, 80, 60, 20, 30, 50, 100 };
+    void* out = NULL;
+
+    /* Empty heaps hand pushpop data straight back and ignore replace */
+    assert(0 == binary_heap_pushpop(heap, &values[0], &out) && "Expected pushpop on an empty heap to hand data back");
+    assert(out == &values[0] && "Expected pushpop value [10]");
+    assert(0 == binary_heap_replace(heap, &values[0], &out) && "Expected replace on an empty heap to fail");
+    assert(binary_heap_size(heap) == 0 && "Expected heap size of [0]");
+
+    size_t i;
+    for (i = 1; i < 9; ++i)
+        binary_heap_push(heap, &values[i]);
+
+    /* 10 beats the top [20], so comes straight back after one comparison */
+    size_t before = binary_heap_comparisons(heap);
+    assert(0 == binary_heap_pushpop(heap, &values[0], &out) && "Expected a new best to be handed back");
+    assert(out == &values[0] && "Expected pushpop value [10]");
+    assert(binary_heap_comparisons(heap) == before + BINARY_HEAP_COUNT_COMPARISONS && "Expected one comparison");
+
+    /* 100 does not, the top comes out and 100 goes in */
+    assert(1 == binary_heap_pushpop(heap, &values[9], &out) && "Expected data to be added");
+    assert(*(int*)out == 20 && "Expected pushpop value [20]");
+
+    /* replace always inserts, even a new best */
+    assert(1 == binary_heap_replace(heap, &values[0], &out) && "Expected replace to succeed");
+    assert(*(int*)out == 30 && "Expected replace value [30]");
+
+    int expected[8] = { 10, 40, 50, 60, 70, 80, 90, 100 };
+    for (i = 0; i < 8; ++i) {
+        binary_heap_pop(heap, &out);
+        assert(*(int*)out == expected[i] && "Expected pops in ascending order");
+    }
+
+    binary_heap_destroy(heap);
+
+    /* Periodic timers: replace skips the sift up pop then push needs */
+    binary_heap_t* fused;
+    binary_heap_t* split;
+    binary_heap_new_keyed(&fused);
+    binary_heap_new_keyed(&split);
+
+    for (i = 0; i < 1000; ++i) {
+        binary_heap_push_key(fused, (i * 7919) % 1000, NULL);
+        binary_heap_push_key(split, (i * 7919) % 1000, NULL);
+    }
+    size_t fused_before = binary_heap_comparisons(fused);
+    size_t split_before = binary_heap_comparisons(split);
+
+    uint64_t now = 0;
+    for (i = 0; i < 1000; ++i) {
+        binary_heap_peek_key(fused, &now);
+        binary_heap_replace_key(fused, now + 1000, NULL, &out);
+
+        binary_heap_peek_key(split, &now);
+        binary_heap_pop(split, &out);
+        binary_heap_push_key(split, now + 1000, NULL);
+    }
+    binary_heap_peek_key(fused, &now);
+    assert(now == 1000 && "Expected every timer to be rescheduled once");
+
+    size_t fused_cost = binary_heap_comparisons(fused) - fused_before;
+    size_t split_cost = binary_heap_comparisons(split) - split_before;
+#if BINARY_HEAP_COUNT_COMPARISONS
+    assert(fused_cost < split_cost && "Expected replace to need fewer comparisons");
+#else
+    assert(fused_cost == 0 && split_cost == 0 && "Expected no comparisons counted");
+#endif
+
+    assert(0 == binary_heap_pushpop_key(fused, 0, &values[0], &out) && "Expected a new best key to be handed back");
+    assert(out == &values[0] && "Expected pushpop payload [10]");
+
+    binary_heap_destroy(fused);
+    binary_heap_destroy(split);
+}
+
+void test_binary_heap_drain_sorted()
+{
+    binary_heap_t* heap;
+    binary_heap_new(&heap, &min);
+
+    size_t count = 1;
+    assert(binary_heap_drain_sorted(heap, &count) == NULL && "Expected no buffer from an empty heap");
+    assert(count == 0 && "Expected a count of [0]");
+
+    int values[100];
+    size_t i;
+    for (i = 0; i < 100; ++i) {
+        values[i] = (int)((i * 37) % 100);
+        binary_heap_push(heap, &values[i]);
+    }
+
+    void** sorted = (void**)binary_heap_drain_sorted(heap, &count);
+    assert(sorted && count == 100 && "Expected a buffer of [100] elements");
+    for (i = 0; i < 100; ++i)
+        assert(*(int*)sorted[i] == (int)i && "Expected the buffer in ascending order");
+    BINARY_HEAP_FREE(sorted);
+
+    /* The drained heap is empty and reusable */
+    assert(binary_heap_size(heap) == 0 && binary_heap_capacity(heap) == 0 && "Expected an empty heap with no storage");
+    for (i = 0; i < 100; ++i)
+        assert(binary_heap_push(heap, &values[i]) && "Expected a drained heap to be reusable");
+
+    /* Partial drains sort only the top k */
+    sorted = (void**)binary_heap_drain_partial(heap, 10, &count);
+    assert(count == 100 && "Expected all [100] elements in the buffer");
+    int seen = 0;
+    for (i = 0; i < 100; ++i) {
+        if (i < 10)
+            assert(*(int*)sorted[i] == (int)i && "Expected the top k in ascending order");
+        else
+            assert(*(int*)sorted[i] >= 10 && "Expected the rest after the top k");
+        seen += *(int*)sorted[i];
+    }
+    assert(seen == 99 * 100 / 2 && "Expected every element in the buffer");
+    BINARY_HEAP_FREE(sorted);
+
+    binary_heap_destroy(heap);
+
+    /* Keyed heaps hand back payloads */
+    binary_heap_new_keyed(&heap);
+    for (i = 0; i < 100; ++i)
+        binary_heap_push_key(heap, (uint64_t)values[i], &values[i]);
+
+    sorted = (void**)binary_heap_drain_sorted(heap, &count);
+    for (i = 0; i < 100; ++i)
+        assert(*(int*)sorted[i] == (int)i && "Expected payloads in key order");
+    BINARY_HEAP_FREE(sorted);
+
+    binary_heap_destroy(heap);
+
+    /* Sized heaps hand back elements */
+    binary_heap_new_sized(&heap, sizeof(job_t), &job_min);
+    job_t job;
+    for (i = 0; i < 50; ++i) {
+        job.priority = values[i];
+        job.payload[0] = (double)values[i];
+        binary_heap_push_value(heap, &job);
+    }
+
+    job_t* jobs = (job_t*)binary_heap_drain_sorted(heap, &count);
+    for (i = 1; i < count; ++i) {
+        assert(jobs[i - 1].priority <= jobs[i].priority && "Expected elements in ascending order");
+        assert(jobs[i].payload[0] == (double)jobs[i].priority && "Expected payload to move with its element");
+    }
+    BINARY_HEAP_FREE(jobs);
+
+    binary_heap_destroy(heap);
+
+    /* Heaps with their own allocator keep their storage */
+    binary_heap_allocator_t counting = { &counting_alloc, &counting_realloc, &counting_free };
+    size_t live = 0;
+    binary_heap_new_with_allocator(&heap, &min, &counting, &live);
+    for (i = 0; i < 100; ++i)
+        binary_heap_push(heap, &values[i]);
+
+    count = 1;
+    assert(binary_heap_drain_sorted(heap, &count) == NULL && count == 0 && "Expected no buffer from an allocator heap");
+    assert(binary_heap_drain_partial(heap, 10, &count) == NULL && count == 0 && "Expected no buffer from an allocator heap");
+    assert(binary_heap_size(heap) == 100 && "Expected the heap to keep [100] elements");
+
+    void* top;
+    binary_heap_pop(heap, &top);
+    assert(*(int*)top == 0 && "Expected pop value [0]");
+    binary_heap_destroy(heap);
+    assert(live == 0 && "Expected every allocated byte to be freed");
+
+    /* Sorting in place keeps the storage and every element */
+    binary_heap_new_sized(&heap, sizeof(int), &min);
+    assert(binary_heap_reserve(heap, 1000) && binary_heap_capacity(heap) == 1000 && "Expected room for exactly [1000]");
+    for (i = 0; i < 100; ++i)
+        binary_heap_push_value(heap, &values[i]);
+
+    int* in_place = (int*)binary_heap_sort_in_place(heap, &count);
+    assert(count == 100 && binary_heap_size(heap) == 100 && "Expected the heap to keep [100] elements");
+    for (i = 0; i < 100; ++i)
+        assert(in_place[i] == (int)i && "Expected the storage in ascending order");
+
+    int popped;
+    binary_heap_pop_value(heap, &popped);
+    assert(popped == 0 && "Expected the sorted heap to still pop in order");
+
+    binary_heap_clear(heap);
+    assert(binary_heap_size(heap) == 0 && binary_heap_capacity(heap) == 1000 && "Expected an empty heap keeping its storage");
+    binary_heap_destroy(heap);
+
+    /* Drained bounded heaps take offers again */
+    binary_heap_new_bounded(&heap, &min, 10);
+    for (i = 0; i < 100; ++i)
+        binary_heap_offer(heap, &values[i], NULL);
+
+    sorted = (void**)binary_heap_drain_sorted(heap, &count);
+    assert(count == 10 && *(int*)sorted[0] == 90 && *(int*)sorted[9] == 99 && "Expected the [10] largest in pop order");
+    BINARY_HEAP_FREE(sorted);
+
+    for (i = 0; i < 100; ++i)
+        binary_heap_offer(heap, &values[i], NULL);
+    assert(binary_heap_size(heap) == 10 && "Expected a drained bounded heap to fill up again");
+
+    binary_heap_peek(heap, &top);
+    assert(*(int*)top == 90 && "Expected peek value [90]");
+    binary_heap_destroy(heap);
+}
+
+void test_binary_heap_simd()
+{
+    binary_heap_t* simd;
+    binary_heap_t* scalar;
+    binary_heap_new_keyed(&simd);
+    binary_heap_new_keyed(&scalar);
+
+    /* Pointer heaps always compare one at a time */
+    binary_heap_t* heap;
+    binary_heap_new(&heap, &min);
+    assert(!binary_heap_set_simd(heap, 1) && "Expected no SIMD for pointer heaps");
+    binary_heap_destroy(heap);
+
+    assert(!binary_heap_set_simd(scalar, 0) && "Expected SIMD to be off");
+    binary_heap_set_simd(simd, 1);
+
+    /* Keys with the top bit set and duplicates, so ties and unsigned
+     * order both matter */
+    static int payloads[5000];
+    uint64_t x = 88172645463325252ULL;
+    size_t i;
+    for (i = 0; i < 5000; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        uint64_t key = (i % 3 == 0 ? x % 64 : x);
+        payloads[i] = (int)i;
+        binary_heap_push_key(simd, key, &payloads[i]);
+        binary_heap_push_key(scalar, key, &payloads[i]);
+    }
+
+    uint64_t last = 0;
+    uint64_t key, other;
+    void* a;
+    void* b;
+    for (i = 0; i < 5000; ++i) {
+        binary_heap_peek_key(simd, &key);
+        binary_heap_peek_key(scalar, &other);
+        binary_heap_pop(simd, &a);
+        binary_heap_pop(scalar, &b);
+        assert(key >= last && "Expected keys in ascending unsigned order");
+        assert(key == other && a == b && "Expected SIMD to pick the same children as scalar compares");
+        last = key;
+    }
+
+    assert(binary_heap_comparisons(simd) == binary_heap_comparisons(scalar) && "Expected the same comparison counts");
+
+    binary_heap_destroy(simd);
+    binary_heap_destroy(scalar);
+}
+
+void test_minmax_heap()
+{
+    minmax_heap_t* heap;
+    assert(minmax_heap_new(&heap, &min) && "Expected successful min-max heap creation");
+
+    void* out = NULL;
+    assert(!minmax_heap_peek_min(heap, &out) && !minmax_heap_peek_max(heap, &out) && "Expected peek on empty heap to fail");
+    assert(!minmax_heap_pop_min(heap, &out) && !minmax_heap_pop_max(heap, &out) && "Expected pop on empty heap to fail");
+
+    /* Every value twice, [0, 500) */
+    int values[1000];
+    size_t i;
+    for (i = 0; i < 1000; ++i) {
+        values[i] = (int)((i * 37) % 500);
+        assert(minmax_heap_push(heap, &values[i]) && "Expected successful min-max heap push");
+    }
+
+    assert(minmax_heap_size(heap) == 1000 && "Expected heap size of [1000]");
+    minmax_heap_peek_min(heap, &out);
+    assert(*(int*)out == 0 && "Expected peek min value [0]");
+    minmax_heap_peek_max(heap, &out);
+    assert(*(int*)out == 499 && "Expected peek max value [499]");
+
+    /* Alternate ends, sorted position k holds k / 2 */
+    size_t lo = 0, hi = 1000;
+    for (i = 0; i < 1000; ++i) {
+        if (i % 3 == 0) {
+            assert(minmax_heap_pop_max(heap, &out) && "Expected successful pop max");
+            assert(*(int*)out == (int)(--hi / 2) && "Expected pop max in descending order");
+        }
+        else {
+            assert(minmax_heap_pop_min(heap, &out) && "Expected successful pop min");
+            assert(*(int*)out == (int)(lo++ / 2) && "Expected pop min in ascending order");
+        }
+    }
+    assert(minmax_heap_size(heap) == 0 && "Expected an empty heap");
+
+    /* Mixed pushes and pops from both ends, checked against value counts */
+    int counts[500] = { 0 };
+    size_t size = 0;
+    for (i = 0; i < 20000; ++i) {
+        size_t op = (i * 7919) % 5;
+        if (op < 3 || size == 0) {
+            int* value = &values[(i * 613) % 1000];
+            minmax_heap_push(heap, value);
+            ++counts[*value];
+            ++size;
+            continue;
+        }
+
+        int expected = (op == 3 ? 0 : 499);
+        while (!counts[expected])
+            expected += (op == 3 ? 1 : -1);
+
+        if (op == 3)
+            minmax_heap_pop_min(heap, &out);
+        else
+            minmax_heap_pop_max(heap, &out);
+        assert(*(int*)out == expected && "Expected pop to match the reference min or max");
+        --counts[expected];
+        --size;
+    }
+    assert(minmax_heap_size(heap) == size && "Expected heap size to match the reference");
+
+    minmax_heap_destroy(heap);
+}
+
+void test_binary_heap_radix()
+{
+    binary_heap_t* heap;
+    binary_heap_new_radix(&heap);
+
+    void* out = NULL;
+    uint64_t key = 0;
+    assert(binary_heap_size(heap) == 0 && "Expected initial heap size of 0");
+    assert(!binary_heap_peek_key(heap, &key) && "Expected peek key on empty heap to fail");
+    binary_heap_peek(heap, &out);
+    assert(out == NULL && "Expected peek value [NULL]");
+
+    /* Event simulation: pop the next event, schedule it again later, with
+     * equal times and a jump past 2^32 */
+    static int payloads[1000];
+    size_t i;
+    for (i = 0; i < 1000; ++i) {
+        payloads[i] = (int)i;
+        assert(binary_heap_push_key(heap, (uint64_t)((i * 37) % 500), &payloads[i]) && "Expected successful radix push");
+    }
+    assert(binary_heap_push_key(heap, (uint64_t)1 << 40, &payloads[0]) && "Expected successful radix push");
+    assert(binary_heap_size(heap) == 1001 && "Expected heap size of [1001]");
+
+    uint64_t last = 0;
+    for (i = 0; i < 5000; ++i) {
+        assert(binary_heap_peek_key(heap, &key) && "Expected a top key");
+        assert(key >= last && "Expected keys in ascending order");
+        last = key;
+
+        void* top;
+        binary_heap_peek(heap, &top);
+        binary_heap_pop(heap, &out);
+        assert(out == top && "Expected pop to return the peeked payload");
+        if (key < ((uint64_t)1 << 40))
+            binary_heap_push_key(heap, key + (i * 7919) % 64, out);
+    }
+    assert(binary_heap_size(heap) > 0 && "Expected events left");
+
+    /* Drain in key order */
+    void* drained[2000];
+    size_t count = binary_heap_size(heap);
+    assert(binary_heap_pop_n(heap, drained, 2000) == count && "Expected pop_n to drain the heap");
+    assert(binary_heap_size(heap) == 0 && "Expected an empty heap");
+    assert(!binary_heap_peek_key(heap, &key) && "Expected peek key on drained heap to fail");
+
+    /* Clearing forgets the last popped key, 2^40, so smaller keys work again */
+    binary_heap_push_key(heap, ((uint64_t)1 << 40) + 1, &payloads[0]);
+    binary_heap_clear(heap);
+    assert(binary_heap_size(heap) == 0 && !binary_heap_peek_key(heap, &key) && "Expected an empty heap after clear");
+
+    for (i = 0; i < 100; ++i)
+        assert(binary_heap_push_key(heap, (uint64_t)(99 - i), &payloads[i]) && "Expected successful radix push after clear");
+    for (i = 0; i < 100; ++i) {
+        assert(binary_heap_peek_key(heap, &key) && key == i && "Expected keys in ascending order after clear");
+        binary_heap_pop(heap, &out);
+        assert(out == &payloads[99 - i] && "Expected the payload pushed with the key");
+    }
+
+    binary_heap_destroy(heap);
+}
+
+/* Timer for lazy deletion tests, min compares the deadline */
+typedef struct timer
+{
+    int deadline;
+    int cancelled;
+} timer_t_;
+
+int timer_dead(void* data)
+{
+    return ((timer_t_*)data)->cancelled;
+}
+
+void test_binary_heap_tombstones()
+{
+    binary_heap_t* heap;
+    binary_heap_new(&heap, &min);
+    binary_heap_set_tombstones(heap, &timer_dead, 0.5);
+
+    static timer_t_ timers[1000];
+    size_t i;
+    for (i = 0; i < 1000; ++i) {
+        timers[i].deadline = (int)((i * 37) % 1000);
+        timers[i].cancelled = 0;
+        binary_heap_push(heap, &timers[i]);
+    }
+    assert(binary_heap_capacity(heap) == 1280 && "Expected heap capacity of [1280]");
+
+    /* Cancel the top few, pops and peeks skip them */
+    void* out;
+    for (i = 0; i < 1000; ++i) {
+        if (timers[i].deadline < 3) {
+            timers[i].cancelled = 1;
+            binary_heap_cancel(heap, &timers[i]);
+        }
+    }
+    assert(binary_heap_size(heap) == 997 && "Expected heap size of [997] live timers");
+    binary_heap_peek(heap, &out);
+    assert(((timer_t_*)out)->deadline == 3 && "Expected peek to skip cancelled timers");
+    assert(binary_heap_size(heap) == 997 && "Expected heap size of [997] after skipping");
+
+    /* Cancel every odd deadline, the heap compacts past half dead */
+    for (i = 0; i < 1000; ++i) {
+        if (timers[i].deadline % 2 && !timers[i].cancelled) {
+            timers[i].cancelled = 1;
+            binary_heap_cancel(heap, &timers[i]);
+        }
+    }
+    assert(binary_heap_size(heap) == 498 && "Expected heap size of [498] live timers");
+    assert(binary_heap_capacity(heap) < 1280 && "Expected compaction to shrink storage");
+
+    int last = -1;
+    for (i = 0; i < 498; ++i) {
+        binary_heap_pop(heap, &out);
+        assert(!((timer_t_*)out)->cancelled && "Expected only live timers");
+        assert(((timer_t_*)out)->deadline > last && "Expected pops in ascending order");
+        last = ((timer_t_*)out)->deadline;
+    }
+    assert(binary_heap_size(heap) == 0 && "Expected an empty heap");
+
+    out = NULL;
+    binary_heap_pop(heap, &out);
+    assert(out == NULL && "Expected pop from empty heap to leave out untouched");
+
+    binary_heap_destroy(heap);
+}
+
+void test_binary_heap_save_load()
+{
+    const char* path = "test_heap.bin";
+    binary_heap_t* heap;
+    binary_heap_new_sized(&heap, sizeof(job_t), &job_min);
+
+    job_t job;
+    size_t i;
+    for (i = 0; i < 1000; ++i) {
+        job.priority = (int)((i * 37) % 1000);
+        job.payload[0] = (double)job.priority;
+        job.payload[1] = job.payload[2] = 0.0;
+        binary_heap_push_value(heap, &job);
+    }
+
+    assert(binary_heap_save(heap, path) && "Expected successful heap save");
+    binary_heap_destroy(heap);
+
+    /* Mismatched element sizes are refused */
+    assert(!binary_heap_load(&heap, path, sizeof(int), &min) && "Expected load with the wrong element size to fail");
+    assert(!binary_heap_load(&heap, "missing_heap.bin", sizeof(job_t), &job_min) && "Expected load of a missing file to fail");
+
+    binary_heap_t* loaded = NULL;
+    assert(binary_heap_load(&loaded, path, sizeof(job_t), &job_min) && "Expected successful heap load");
+    assert(binary_heap_size(loaded) == 1000 && "Expected loaded heap size of [1000]");
+    assert(binary_heap_comparisons(loaded) == 0 && "Expected load not to re-heapify");
+
+    /* Pops work straight off the mapping */
+    for (i = 0; i < 10; ++i) {
+        binary_heap_pop_value(loaded, &job);
+        assert(job.priority == (int)i && "Expected pops in ascending order");
+        assert(job.payload[0] == (double)i && "Expected payload to survive the round trip");
+    }
+
+    /* The first push moves storage off the mapping */
+    job.priority = -1;
+    assert(binary_heap_push_value(loaded, &job) && "Expected push onto a loaded heap");
+    binary_heap_pop_value(loaded, &job);
+    assert(job.priority == -1 && "Expected pop value [-1]");
+
+    for (i = 10; i < 1000; ++i) {
+        binary_heap_pop_value(loaded, &job);
+        assert(job.priority == (int)i && "Expected pops in ascending order");
+    }
+    binary_heap_destroy(loaded);
+
+    /* The file itself is untouched by the loaded heap */
+    assert(binary_heap_load(&loaded, path, sizeof(job_t), &job_min) && "Expected successful heap reload");
+    assert(binary_heap_size(loaded) == 1000 && "Expected the file to still hold [1000] elements");
+    binary_heap_destroy(loaded);
+
+    remove(path);
+}
+
+void test_extheap()
+{
+    extheap_t* ext;
+    int out = -1;
+
+    /* 256 ints in memory, so 20000 pushes spill runs and merge them */
+    const char* dirs[2] = { NULL, "." };
+    size_t d;
+    for (d = 0; d < 2; ++d) {
+        assert(extheap_new(&ext, sizeof(int), &min, 256 * 2 * sizeof(int), dirs[d]) && "Expected successful extheap creation");
+        assert(!extheap_pop(ext, &out) && !extheap_peek(ext, &out) && "Expected pop and peek on empty queue to fail");
+
+        int value;
+        size_t i;
+        for (i = 0; i < 20000; ++i) {
+            value = (int)((i * 7919) % 10000);
+            assert(extheap_push(ext, &value) && "Expected successful extheap push");
+        }
+
+        assert(extheap_size(ext) == 20000 && "Expected queue size of [20000]");
+        assert(extheap_runs(ext) > 1 && extheap_runs(ext) <= EXTHEAP_MAX_RUNS && "Expected spilled runs");
+
+        /* Pops interleaved with pushes of larger values, every value twice */
+        for (i = 0; i < 10000; ++i) {
+            assert(extheap_peek(ext, &value) && "Expected successful extheap peek");
+            assert(extheap_pop(ext, &out) && "Expected successful extheap pop");
+            assert(out == value && out == (int)(i / 2) && "Expected pops in ascending order");
+
+            if (i % 4 == 0) {
+                value = 20000 + (int)i;
+                extheap_push(ext, &value);
+            }
+        }
+
+        int last = -1;
+        while (extheap_pop(ext, &out)) {
+            assert(out >= last && "Expected pops in ascending order");
+            last = out;
+        }
+        assert(last == 20000 + 9996 && "Expected the last pushed value last");
+        assert(extheap_size(ext) == 0 && extheap_runs(ext) == 0 && "Expected an empty queue with no runs");
+
+        extheap_destroy(ext);
+    }
+
+    /* Runs cut short on disk fail pops instead of losing elements */
+    extheap_new(&ext, sizeof(int), &min, 256 * 2 * sizeof(int), ".");
+    int value;
+    size_t i;
+    for (i = 0; i < 2000; ++i) {
+        value = (int)i;
+        extheap_push(ext, &value);
+    }
+    assert(extheap_runs(ext) > 1 && "Expected spilled runs");
+
+    char path[128];
+    unsigned long seq;
+    for (seq = 0; seq < 64; ++seq) {
+        sprintf(path, "./extheap-%p-%lu.run", (void*)ext, seq);
+        FILE* file = fopen(path, "rb");
+        if (file) {
+            fclose(file);
+            file = fopen(path, "wb");
+            fclose(file);
+        }
+    }
+
+    size_t popped = 0;
+    while (extheap_pop(ext, &out))
+        ++popped;
+    assert(popped < 2000 && extheap_size(ext) == 2000 - popped && "Expected the unread elements to still be counted");
+    assert(!extheap_pop(ext, &out) && extheap_size(ext) == 2000 - popped && "Expected failed pops to leave the queue unchanged");
+    extheap_destroy(ext);
+}
+
+/* Sorted int array source for the k-way merge tests */
+typedef struct {
+    const int* data;
+    size_t     count;
+    size_t     next;
+} int_source_t;
+
+int int_source_next(void* source, void* out)
+{
+    int_source_t* src = (int_source_t*)source;
+    if (src->next == src->count)
+        return 0;
+
+    *(int*)out = src->data[src->next++];
+    return 1;
+}
+
+void test_kmerge()
+{
+    /* Source s holds s, s + k, s + 2k, ... with s + 1 elements, plus some empty sources */
+    enum { K = 37, TOTAL = K * (K + 1) / 2 };
+    static int data[K][K];
+    int_source_t sources[K];
+    void* ptrs[K];
+    int out[TOTAL + 1];
+    kmerge_t* merge;
+    size_t s, i;
+
+    binary_heap_t* heap;
+    binary_heap_new_sized(&heap, sizeof(int), &min);
+    int value = 5, top = -1;
+    assert(!binary_heap_replace_value(heap, &value, &top) && top == -1 && "Expected replace on empty heap to fail");
+    for (i = 0; i < 10; ++i) {
+        value = (int)i;
+        binary_heap_push_value(heap, &value);
+    }
+    value = 100;
+    assert(binary_heap_replace_value(heap, &value, &top) && top == 0 && "Expected replace to hand back [0]");
+    binary_heap_peek(heap, (void**)&ptrs[0]);
+    assert(*(int*)ptrs[0] == 1 && binary_heap_size(heap) == 10 && "Expected peek value [1] and size [10]");
+    binary_heap_destroy(heap);
+
+    int mode;
+    for (mode = KMERGE_HEAP; mode <= KMERGE_LOSER_TREE; ++mode) {
+        size_t expected = 0;
+        for (s = 0; s < K; ++s) {
+            sources[s].data = data[s];
+            sources[s].count = (s % 5 == 3 ? 0 : s + 1);
+            sources[s].next = 0;
+            for (i = 0; i < sources[s].count; ++i)
+                data[s][i] = (int)(s + i * K);
+            expected += sources[s].count;
+            ptrs[s] = &sources[s];
+        }
+
+        assert(kmerge_new(&merge, sizeof(int), &min, &int_source_next, ptrs, K, mode) && "Expected successful merge creation");
+
+        /* Batches of 10 until a short read */
+        size_t total = 0, n;
+        while ((n = kmerge_read(merge, out + total, 10)) == 10)
+            total += n;
+        total += n;
+
+        assert(total == expected && "Expected every element of every source");
+        for (i = 1; i < total; ++i)
+            assert(out[i - 1] < out[i] && "Expected merged output in ascending order");
+        assert(kmerge_read(merge, out, 10) == 0 && "Expected an exhausted merge to read nothing");
+        kmerge_destroy(merge);
+    }
+
+    /* With 8 equal length sources every element replays 3 matches */
+    for (s = 0; s < 8; ++s) {
+        sources[s].data = data[s];
+        sources[s].count = 20;
+        sources[s].next = 0;
+        for (i = 0; i < 20; ++i)
+            data[s][i] = (int)(i * 8 + (7 - s));
+    }
+    kmerge_new(&merge, sizeof(int), &min, &int_source_next, ptrs, 8, KMERGE_LOSER_TREE);
+    assert(kmerge_comparisons(merge) == 7 && "Expected [7] matches to build the tree");
+    assert(kmerge_read(merge, out, 8 * 19) == 8 * 19 && "Expected a full read");
+    assert(kmerge_comparisons(merge) == 7 + 8 * 19 * 3 && "Expected log2(8) [3] comparisons per element");
+    for (i = 0; i < 8 * 19; ++i)
+        assert(out[i] == (int)i && "Expected merged output in ascending order");
+    kmerge_destroy(merge);
+
+    /* No sources at all, and a single source */
+    assert(kmerge_new(&merge, sizeof(int), &min, &int_source_next, NULL, 0, KMERGE_LOSER_TREE) && "Expected successful empty merge");
+    assert(kmerge_read(merge, out, 10) == 0 && "Expected an empty merge to read nothing");
+    kmerge_destroy(merge);
+
+    sources[0].next = 0;
+    kmerge_new(&merge, sizeof(int), &min, &int_source_next, ptrs, 1, KMERGE_HEAP);
+    assert(kmerge_read(merge, out, 100) == 20 && out[19] == 159 && "Expected the single source passed through");
+    kmerge_destroy(merge);
+}
+
+void test_binary_heap_iter()
+{
+    binary_heap_t* heap;
+    binary_heap_iter_t* iter;
+    void* out;
+    int values[1000];
+    size_t i;
+
+    /* Empty heap */
+    binary_heap_new(&heap, &min);
+    assert(binary_heap_iter_new(&iter, heap, 0) && "Expected successful iterator creation");
+    assert(!binary_heap_iter_next(iter, &out) && out == NULL && "Expected nothing from an empty heap");
+    binary_heap_iter_destroy(iter);
+
+    for (i = 0; i < 1000; ++i) {
+        values[i] = (int)((i * 7919) % 1000);
+        binary_heap_push(heap, &values[i]);
+    }
+
+    /* Iterating only reads the heap, so its comparisons go uncounted */
+    size_t before = binary_heap_comparisons(heap);
+    binary_heap_iter_new(&iter, heap, 10);
+    for (i = 0; i < 10; ++i) {
+        assert(binary_heap_iter_next(iter, &out) && "Expected a next element");
+        assert(*(int*)out == (int)i && "Expected elements in ascending order");
+    }
+    binary_heap_iter_destroy(iter);
+    assert(binary_heap_comparisons(heap) == before && "Expected no comparisons counted for the top k");
+
+    /* A full walk sees everything, and leaves the heap as it was */
+    binary_heap_iter_new(&iter, heap, 0);
+    for (i = 0; binary_heap_iter_next(iter, &out); ++i)
+        assert(*(int*)out == (int)i && "Expected elements in ascending order");
+    assert(i == 1000 && "Expected every element");
+    binary_heap_iter_destroy(iter);
+    assert(binary_heap_comparisons(heap) == before && "Expected no comparisons counted for a full walk");
+
+    assert(binary_heap_size(heap) == 1000 && "Expected heap size of [1000]");
+    for (i = 0; i < 1000; ++i) {
+        binary_heap_pop(heap, &out);
+        assert(*(int*)out == (int)i && "Expected pops in ascending order");
+    }
+    binary_heap_destroy(heap);
+
+    /* Keyed heaps visit payloads, and cancelled timers are skipped */
+    timer_t_ timers[100];
+    binary_heap_new_keyed(&heap);
+    binary_heap_set_tombstones(heap, &timer_dead, 0.9);
+    for (i = 0; i < 100; ++i) {
+        timers[i].deadline = (int)((i * 37) % 100);
+        timers[i].cancelled = 0;
+        binary_heap_push_key(heap, (uint64_t)timers[i].deadline, &timers[i]);
+    }
+    for (i = 0; i < 100; i += 3) {
+        timers[i].cancelled = 1;
+        binary_heap_cancel(heap, &timers[i]);
+    }
+
+    int last = -1;
+    size_t seen = 0;
+    binary_heap_iter_new(&iter, heap, 5);
+    while (binary_heap_iter_next(iter, &out)) {
+        assert(!((timer_t_*)out)->cancelled && "Expected cancelled timers to be skipped");
+        assert(((timer_t_*)out)->deadline > last && "Expected deadlines in ascending order");
+        last = ((timer_t_*)out)->deadline;
+        ++seen;
+    }
+    binary_heap_iter_destroy(iter);
+    assert(seen == binary_heap_size(heap) && seen == 66 && "Expected [66] live timers");
+    binary_heap_destroy(heap);
+
+    /* Sized heaps visit pointers to the stored elements */
+    binary_heap_new_sized(&heap, sizeof(int), &min);
+    for (i = 0; i < 50; ++i)
+        binary_heap_push_value(heap, &values[i]);
+    binary_heap_iter_new(&iter, heap, 1);
+    last = -1;
+    for (i = 0; binary_heap_iter_next(iter, &out); ++i) {
+        assert(*(int*)out > last && "Expected elements in ascending order");
+        last = *(int*)out;
+    }
+    assert(i == 50 && "Expected every element");
+    binary_heap_iter_destroy(iter);
+    binary_heap_destroy(heap);
+}
+
+/* Array order of a heap, recorded by traverse */
+int* layout_out;
+size_t layout_count;
+
+void record_layout(void* data)
+{
+    layout_out[layout_count++] = *(int*)data;
+}
+
+/* Min or max by the sign of order, flipped to unorder a whole heap */
+int order = 1;
+int ordered(void* a, void* b)
+{
+    return order * min(a, b);
+}
+
+void test_binary_heap_heapify_parallel()
+{
+    /* Enough elements for 4 threads to get a share */
+    enum { N = 70000 };
+    int* values = (int*)malloc(N * sizeof(int));
+    void** data = (void**)malloc(N * sizeof(void*));
+    int* serial = (int*)malloc(N * sizeof(int));
+    int* parallel = (int*)malloc(N * sizeof(int));
+    assert(values && data && serial && parallel && "Expected test allocations");
+
+    size_t i;
+    for (i = 0; i < N; ++i) {
+        values[i] = (int)((i * 7919) % 10007);
+        data[i] = &values[i];
+    }
+
+    /* Serial and parallel heapify of the same max heap as a min heap, on
+     * pointer heaps and on sized heaps, whose sifts hold elements by value */
+    size_t threads[4] = { 1, 2, 3, 0 };
+    size_t t;
+    int sized;
+    for (sized = 0; sized < 2; ++sized) {
+        for (t = 0; t < 4; ++t) {
+            binary_heap_t* heaps[2];
+            size_t comparisons[2];
+            int h;
+
+            for (h = 0; h < 2; ++h) {
+                order = -1;
+                if (sized) {
+                    binary_heap_new_sized(&heaps[h], sizeof(int), &ordered);
+                    for (i = 0; i < N; ++i)
+                        binary_heap_push_value(heaps[h], &values[i]);
+                }
+                else {
+                    binary_heap_new_from_array(&heaps[h], &ordered, data, N);
+                }
+
+                order = 1;
+                size_t before = binary_heap_comparisons(heaps[h]);
+                if (h == 0)
+                    binary_heap_heapify(heaps[h]);
+                else
+                    binary_heap_heapify_parallel(heaps[h], threads[t]);
+                comparisons[h] = binary_heap_comparisons(heaps[h]) - before;
+
+                layout_out = (h == 0 ? serial : parallel);
+                layout_count = 0;
+                binary_heap_traverse(heaps[h], &record_layout);
+            }
+
+            assert(comparisons[0] == comparisons[1] && "Expected the same comparisons as a serial heapify");
+            assert(memcmp(serial, parallel, N * sizeof(int)) == 0 && "Expected the same heap as a serial heapify");
+
+            int last = -1;
+            for (i = 0; i < N; ++i) {
+                void* top;
+                binary_heap_peek(heaps[1], &top);
+                assert(*(int*)top >= last && "Expected pops in ascending order");
+                last = *(int*)top;
+                if (sized)
+                    binary_heap_pop_value(heaps[1], serial);
+                else
+                    binary_heap_pop(heaps[1], &top);
+            }
+
+            binary_heap_destroy(heaps[0]);
+            binary_heap_destroy(heaps[1]);
+        }
+    }
+
+    /* Small heaps stay serial */
+    binary_heap_t* heap;
+    order = -1;
+    binary_heap_new_from_array(&heap, &ordered, data, 10);
+    order = 1;
+    binary_heap_heapify_parallel(heap, 4);
+    void* top;
+    binary_heap_peek(heap, &top);
+    assert(*(int*)top == 0 && "Expected peek value [0]");
+    binary_heap_destroy(heap);
+
+    free(values);
+    free(data);
+    free(serial);
+    free(parallel);
+}
+
+void test_binary_heap_clear()
+{
+    binary_heap_t* heap;
+    binary_heap_new(&heap, &min);
+
+    /* Reserving past the largest capacity fails and leaves the heap alone */
+    size_t capacity = binary_heap_capacity(heap);
+    assert(!binary_heap_reserve(heap, (size_t)-1) && "Expected reserving SIZE_MAX to fail");
+    assert(binary_heap_capacity(heap) == capacity && "Expected the capacity unchanged");
+    assert(binary_heap_reserve(heap, 500) && binary_heap_capacity(heap) >= 500 && "Expected room for [500]");
+    capacity = binary_heap_capacity(heap);
+
+    size_t count = 1;
+    assert(binary_heap_sort_in_place(heap, &count) == NULL && count == 0 && "Expected nothing to sort in an empty heap");
+
+    /* Cancelled elements are compacted away before sorting */
+    static timer_t_ timers[500];
+    size_t i;
+    binary_heap_set_tombstones(heap, &timer_dead, 0.9);
+    for (i = 0; i < 500; ++i) {
+        timers[i].deadline = (int)((i * 37) % 500);
+        timers[i].cancelled = i % 5 == 0;
+        binary_heap_push(heap, &timers[i]);
+    }
+    assert(binary_heap_capacity(heap) == capacity && "Expected no growth within the reservation");
+    for (i = 0; i < 500; i += 5)
+        binary_heap_cancel(heap, &timers[i]);
+
+    timer_t_** sorted = (timer_t_**)binary_heap_sort_in_place(heap, &count);
+    assert(count == 400 && binary_heap_size(heap) == 400 && "Expected [400] live timers");
+    for (i = 0; i < count; ++i) {
+        assert(!sorted[i]->cancelled && "Expected cancelled timers to be compacted away");
+        assert((i == 0 || sorted[i - 1]->deadline < sorted[i]->deadline) && "Expected the storage in ascending order");
+    }
+
+    /* A cleared heap keeps its storage and works as new */
+    binary_heap_clear(heap);
+    assert(binary_heap_size(heap) == 0 && binary_heap_capacity(heap) == capacity && "Expected an empty heap keeping its storage");
+
+    void* out = &count;
+    binary_heap_peek(heap, &out);
+    assert(out == NULL && "Expected peek value [NULL]");
+
+    for (i = 0; i < 10; ++i) {
+        timers[i].cancelled = 0;
+        binary_heap_push(heap, &timers[9 - i]);
+    }
+    for (i = 0; i < 10; ++i) {
+        binary_heap_pop(heap, &out);
+        assert(out == &timers[i] && "Expected pops in ascending order after clear");
+    }
+    binary_heap_destroy(heap);
+}
+
 void test_binary_heap_destroy()
 {
     binary_heap_t* heap;
@@ -431,6 +2100,102 @@ int main(void)
     test_binary_heap_traverse();
     printf("    OK\n");
 
+    printf("Running test: test_binary_heap_new_from_array()");
+    test_binary_heap_new_from_array();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_heapify()");
+    test_binary_heap_heapify();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_push_n_pop_n()");
+    test_binary_heap_push_n_pop_n();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_sized()");
+    test_binary_heap_sized();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_keyed()");
+    test_binary_heap_keyed();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_bottom_up()");
+    test_binary_heap_bottom_up();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_handles()");
+    test_binary_heap_handles();
+    printf("    OK\n");
+
+    printf("Running test: test_multiqueue()");
+    test_multiqueue();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_allocator()");
+    test_binary_heap_allocator();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_stats()");
+    test_binary_heap_stats();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_merge()");
+    test_binary_heap_merge();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_bounded()");
+    test_binary_heap_bounded();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_pushpop_replace()");
+    test_binary_heap_pushpop_replace();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_drain_sorted()");
+    test_binary_heap_drain_sorted();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_simd()");
+    test_binary_heap_simd();
+    printf("    OK\n");
+
+    printf("Running test: test_minmax_heap()");
+    test_minmax_heap();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_radix()");
+    test_binary_heap_radix();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_tombstones()");
+    test_binary_heap_tombstones();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_save_load()");
+    test_binary_heap_save_load();
+    printf("    OK\n");
+
+    printf("Running test: test_extheap()");
+    test_extheap();
+    printf("    OK\n");
+
+    printf("Running test: test_kmerge()");
+    test_kmerge();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_iter()");
+    test_binary_heap_iter();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_heapify_parallel()");
+    test_binary_heap_heapify_parallel();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_clear()");
+    test_binary_heap_clear();
+    printf("    OK\n");
+
     printf("Running test: test_binary_heap_destroy()");
     test_binary_heap_destroy();
     printf("    OK\n");
@@ -0,0 +1,278 @@
+/*
+ * test_hpp.cpp
+ * Copyleft (C) 2016-2017 Chad Mowery
+ *
+ *
+ * test_hpp.cpp is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * test_hpp.cpp is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with binaryheap.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "binaryheap.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using binaryheap::binary_heap;
+
+/* NOTE: All tests assume minheap comparisons unless stated otherwise */
+
+/* Test comparator for move-only elements */
+struct ptr_less
+{
+    bool operator()(const std::unique_ptr<int>& a, const std::unique_ptr<int>& b) const
+    {
+        return *a < *b;
+    }
+};
+
+void test_binary_heap_hpp_push_pop()
+{
+    binary_heap<int> heap;
+
+    assert(heap.size() == 0 && "Expected initial heap size of 0");
+    assert(heap.peek() == nullptr && "Expected peek value [nullptr]");
+
+    int values[10] = { 10, 4, 7, 9, 8, 6, 2, 3, 5, 1 };
+    for (int i = 0; i < 10; ++i)
+        assert(heap.push(values[i]) && "Expected successful heap push");
+
+    assert(heap.size() == 10 && "Expected heap size of [10]");
+    assert(heap.capacity() == BINARY_HEAP_INITIAL_CAPACITY && "Expected heap capacity of BINARY_HEAP_INITIAL_CAPACITY [20]");
+    assert(*heap.peek() == 1 && "Expected peek value [1]");
+    assert(heap.top() == 1 && "Expected top value [1]");
+
+    int out = 0;
+    for (int i = 1; i <= 10; ++i) {
+        assert(heap.pop(out) && "Expected successful heap pop");
+        assert(out == i && "Expected pops in ascending order");
+    }
+
+    out = -1;
+    assert(!heap.pop(out) && "Expected pop from empty heap to fail");
+    assert(out == -1 && "Expected pop from empty heap to leave out untouched");
+}
+
+void test_binary_heap_hpp_resize()
+{
+    binary_heap<int, std::greater<int> > heap;
+
+    for (int i = 0; i < BINARY_HEAP_INITIAL_CAPACITY + 1; ++i)
+        heap.push(i);
+
+    assert(heap.capacity() == BINARY_HEAP_INITIAL_CAPACITY * 2 && "Expected heap to resize to BINARY_HEAP_INITIAL_CAPACITY * 2 [40]");
+    assert(heap.top() == BINARY_HEAP_INITIAL_CAPACITY && "Expected max heap top value [20]");
+
+    /* Copies are independent */
+    binary_heap<int, std::greater<int> > copy(heap);
+    heap.clear();
+    assert(heap.empty() && "Expected cleared heap to be empty");
+    assert(copy.size() == BINARY_HEAP_INITIAL_CAPACITY + 1 && "Expected copy to keep its elements");
+
+    for (int i = BINARY_HEAP_INITIAL_CAPACITY; i >= 0; --i) {
+        assert(copy.top() == i && "Expected pops in descending order");
+        copy.pop();
+    }
+}
+
+void test_binary_heap_hpp_move_only()
+{
+    binary_heap<std::unique_ptr<int>, ptr_less> heap;
+
+    for (int i = 0; i < 50; ++i)
+        heap.emplace(new int((i * 7) % 50));
+
+    int sum = 0;
+    heap.traverse([&sum](const std::unique_ptr<int>& p) { sum += *p; });
+    assert(sum == 49 * 50 / 2 && "Expected traverse to visit every element");
+
+    binary_heap<std::unique_ptr<int>, ptr_less> moved(std::move(heap));
+    assert(heap.size() == 0 && "Expected moved-from heap to be empty");
+
+    std::unique_ptr<int> out;
+    for (int i = 0; i < 50; ++i) {
+        assert(moved.pop(out) && "Expected successful heap pop");
+        assert(*out == i && "Expected pops in ascending order");
+    }
+}
+
+void test_binary_heap_hpp_strings()
+{
+    binary_heap<std::string> heap;
+
+    heap.push("pear");
+    heap.push("apple");
+    heap.emplace(3, 'z');
+    heap.push(std::string("fig"));
+
+    std::string out;
+    heap.pop(out);
+    assert(out == "apple" && "Expected pop value [apple]");
+    heap.pop(out);
+    assert(out == "fig" && "Expected pop value [fig]");
+    heap.pop(out);
+    assert(out == "pear" && "Expected pop value [pear]");
+    heap.pop(out);
+    assert(out == "zzz" && "Expected pop value [zzz]");
+}
+
+void test_binary_heap_hpp_push_own_top()
+{
+    binary_heap<std::string> heap;
+
+    for (int i = 0; i < BINARY_HEAP_INITIAL_CAPACITY; ++i)
+        heap.push(std::string(30, (char)('a' + i)));
+    assert(heap.size() == heap.capacity() && "Expected a full heap");
+
+    /* Pushing the top makes the heap grow while reading from it */
+    heap.push(heap.top());
+    heap.emplace(heap.top());
+    assert(heap.capacity() == BINARY_HEAP_INITIAL_CAPACITY * 2 && "Expected heap to resize to BINARY_HEAP_INITIAL_CAPACITY * 2 [40]");
+
+    std::string out;
+    for (int i = 0; i < 3; ++i) {
+        heap.pop(out);
+        assert(out == std::string(30, 'a') && "Expected three copies of the top");
+    }
+    heap.pop(out);
+    assert(out == std::string(30, 'b') && "Expected pop value [bbb...]");
+}
+
+/* Element whose copies throw once copies_left runs out, counting live ones */
+struct fragile
+{
+    static int live;
+    static int copies_left;
+
+    int value;
+
+    explicit fragile(int v) : value(v) { ++live; }
+    fragile(const fragile& other) : value(other.value)
+    {
+        if (copies_left-- == 0)
+            throw std::runtime_error("copy failed");
+        ++live;
+    }
+    ~fragile() { --live; }
+
+    bool operator<(const fragile& other) const { return value < other.value; }
+};
+
+int fragile::live = 0;
+int fragile::copies_left = -1;
+
+/* Allocator counting the elements it has handed out */
+template <typename T>
+struct counting_allocator
+{
+    typedef T value_type;
+
+    static std::size_t outstanding;
+
+    counting_allocator() {}
+    template <typename U>
+    counting_allocator(const counting_allocator<U>&) {}
+
+    T* allocate(std::size_t n)
+    {
+        T* p = std::allocator<T>().allocate(n);
+        outstanding += n;
+        return p;
+    }
+    void deallocate(T* p, std::size_t n)
+    {
+        outstanding -= n;
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    bool operator==(const counting_allocator&) const { return true; }
+    bool operator!=(const counting_allocator&) const { return false; }
+};
+
+template <typename T>
+std::size_t counting_allocator<T>::outstanding = 0;
+
+void test_binary_heap_hpp_exceptions()
+{
+    typedef binary_heap<fragile, std::less<fragile>, counting_allocator<fragile> > fragile_heap;
+
+    {
+        fragile_heap heap;
+        for (int i = 0; i < 10; ++i)
+            heap.emplace(i);
+
+        /* A copy throwing half way destroys and frees what it made */
+        std::size_t allocated = counting_allocator<fragile>::outstanding;
+        fragile::copies_left = 5;
+        bool thrown = false;
+        try {
+            fragile_heap copy(heap);
+        }
+        catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        fragile::copies_left = -1;
+
+        assert(thrown && "Expected the copy to throw");
+        assert(fragile::live == 10 && "Expected only the original elements alive");
+        assert(counting_allocator<fragile>::outstanding == allocated && "Expected the copy's storage to be freed");
+
+        /* Growing past max_size fails instead of doubling forever */
+        assert(!heap.reserve(std::size_t(-1)) && "Expected reserving SIZE_MAX to fail");
+        assert(!heap.reserve(std::allocator_traits<counting_allocator<fragile> >::max_size(counting_allocator<fragile>()) + 1) &&
+               "Expected reserving past max_size to fail");
+        assert(!heap.reserve(std::allocator_traits<counting_allocator<fragile> >::max_size(counting_allocator<fragile>()) / 2 + 2) &&
+               "Expected a reservation too big to allocate to fail");
+        assert(heap.size() == 10 && heap.top().value == 0 && "Expected a failed reserve to change nothing");
+    }
+
+    assert(fragile::live == 0 && "Expected every element destroyed");
+    assert(counting_allocator<fragile>::outstanding == 0 && "Expected all storage freed");
+}
+
+
+/* Run all the tests! */
+int main(void)
+{
+    printf("\nTESTS BEGIN\n");
+    printf("---------------------------------------------------------------------------\n\n");
+
+    printf("Running test: test_binary_heap_hpp_push_pop()");
+    test_binary_heap_hpp_push_pop();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_hpp_resize()");
+    test_binary_heap_hpp_resize();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_hpp_move_only()");
+    test_binary_heap_hpp_move_only();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_hpp_strings()");
+    test_binary_heap_hpp_strings();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_hpp_push_own_top()");
+    test_binary_heap_hpp_push_own_top();
+    printf("    OK\n");
+
+    printf("Running test: test_binary_heap_hpp_exceptions()");
+    test_binary_heap_hpp_exceptions();
+    printf("    OK\n");
+
+    printf("\n---------------------------------------------------------------------------\n");
+    printf("TESTS END\n");
+    return 0;
+}